@@ -106,6 +106,29 @@ LOCALPROC dbglog_close0(void)
 
 #endif
 
+/* --- instruction trace file --- */
+
+#if WantTraceRing || WantTrapProfile
+LOCALVAR FILE *TraceFile = NULL;
+
+GLOBALOSGLUFUNC blnr TraceFile_Open(char *Name)
+{
+	TraceFile = fopen(Name, "wb");
+	return (NULL != TraceFile);
+}
+
+GLOBALOSGLUPROC TraceFile_Write(ui3p p, ui5r L)
+{
+	(void) fwrite(p, 1, L, TraceFile);
+}
+
+GLOBALOSGLUPROC TraceFile_Close(void)
+{
+	fclose(TraceFile);
+	TraceFile = NULL;
+}
+#endif
+
 /* --- debug settings and utilities --- */
 
 #if ! dbglog_HAVE
@@ -121,11 +144,22 @@ LOCALPROC WriteExtraErr(char *s)
 
 /* --- information about the environment --- */
 
-#define WantColorTransValid 0
+#define WantColorTransValid 1
 
 #include "COMOSGLU.h"
 #include "CONTROLM.h"
 
+#if EmLocalTalk
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <malloc.h>
+
+#include "LTOVRUDP.h"
+#endif
+
 // Used to transfer the final rendered display to the framebuffer
 #define DISPLAY_TRANSFER_FLAGS \
 (GX_TRANSFER_FLIP_VERT(0) | GX_TRANSFER_OUT_TILED(0) | GX_TRANSFER_RAW_COPY(0) | \
@@ -333,7 +367,45 @@ rgba32* LoadPNG( const char* Path, int* OutWidth, int* OutHeight ) {
     return NULL;
 }
 
-static u32* TempTextureBuffer = NULL;
+#define RGBA8( r, g, b, a ) ( ( ( r & 0xFF ) << 24 ) | ( ( g & 0xFF ) << 16 ) | ( ( b & 0xFF ) << 8 ) | ( a & 0xFF ) )
+#define RGB565( r, g, b ) ( ( ( r & 0xF8 ) << 8 ) | ( ( g & 0xFC ) << 3 ) | ( ( b & 0xF8 ) >> 3 ) )
+
+/*
+ * Format of the emulated screen texture and its staging buffer.
+ * RGB565 halves the bytes converted and transferred each frame
+ * compared to RGBA8, and loses nothing for monochrome or the
+ * 16 color palettes. 256 color palettes keep RGBA8 by default
+ * since rounding them to 565 shows up as banding.
+ */
+#ifndef FBTextureCompact
+#if vMacScreenDepth < 3
+#define FBTextureCompact 1
+#else
+#define FBTextureCompact 0
+#endif
+#endif
+
+#if FBTextureCompact
+typedef u16 fbpixel;
+typedef u32 fbpixel2;
+#define FBPIXEL( r, g, b ) RGB565( r, g, b )
+#define FBTEXTURE_GPU_FORMAT GPU_RGB565
+#define FBTEXTURE_TRANSFER_FLAGS TEXTURE_TRANSFER_FLAGS
+#else
+typedef u32 fbpixel;
+typedef u64 fbpixel2;
+#define FBPIXEL( r, g, b ) RGBA8( r, g, b, 0xFF )
+#define FBTEXTURE_GPU_FORMAT GPU_RGBA8
+#define FBTEXTURE_TRANSFER_FLAGS TEXTURE32_TRANSFER_FLAGS
+#endif
+
+#define FBTextureBytes ( 512 * 512 * sizeof( fbpixel ) )
+
+/* Only the 8 row bands of the staging buffer that changed get uploaded */
+#define ScrnTile_Height 512
+#include "SCRNTILE.h"
+
+static fbpixel* TempTextureBuffer = NULL;
 LOCALVAR blnr FBTextureNeedsUpdate = falseblnr;
 
 void UI_UploadTexture32( void* ImageData, C3D_Tex* Texture, int Width, int Height ) {
@@ -341,8 +413,6 @@ void UI_UploadTexture32( void* ImageData, C3D_Tex* Texture, int Width, int Heigh
     GX_DisplayTransfer( ( u32* ) ImageData, GX_BUFFER_DIM( Width, Height ), ( u32* ) Texture->data, GX_BUFFER_DIM( Width, Height ), TEXTURE32_TRANSFER_FLAGS );
 }
 
-#define RGBA8( r, g, b, a ) ( ( ( r & 0xFF ) << 24 ) | ( ( g & 0xFF ) << 16 ) | ( ( b & 0xFF ) << 8 ) | ( a & 0xFF ) )
-
 /* Hack, here for cleaner code later on */
 #if vMacScreenDepth == 0
 	blnr UseColorMode = falseblnr;
@@ -352,109 +422,12 @@ int VideoGetBPP( void ) {
 	return UseColorMode ? ( 1 << vMacScreenDepth ) : 1;
 }
 
-u32 Table1BPP[ 256 ][ 8 ];
-
-#if vMacScreenDepth == 2
-u64 Table4BPP[ 256 ];
-#elif vMacScreenDepth == 3
-u32 Table8BPP[ 256 ];
-#endif
-
-/*
- * Converts a 1bpp packed image and outputs it in RGBA8 format.
- */
-void Convert1BPP( u8* Src, u32* Dest, int Size ) {
-	do {
-		memcpy( Dest, Table1BPP[ *Src++ ], sizeof( u32 ) * 8 );
-		
-		Dest+= 8;
-		Size-= 8;
-	}
-	while ( Size > 0 );
-}
-
-/*
- * Sets up the 1BPP->RGBA8 conversion table.
- */
-LOCALPROC MakeTable1BPP( void ) {
-	int i = 0;
-	
-	for ( i = 0; i < 256; i++ ) {
-		Table1BPP[ i ][ 0 ] = ( i & BIT( 7 ) ) ? 0 : 0xFFFFFFFF;
-		Table1BPP[ i ][ 1 ] = ( i & BIT( 6 ) ) ? 0 : 0xFFFFFFFF;
-		Table1BPP[ i ][ 2 ] = ( i & BIT( 5 ) ) ? 0 : 0xFFFFFFFF;
-		Table1BPP[ i ][ 3 ] = ( i & BIT( 4 ) ) ? 0 : 0xFFFFFFFF;
-		Table1BPP[ i ][ 4 ] = ( i & BIT( 3 ) ) ? 0 : 0xFFFFFFFF;
-		Table1BPP[ i ][ 5 ] = ( i & BIT( 2 ) ) ? 0 : 0xFFFFFFFF;
-		Table1BPP[ i ][ 6 ] = ( i & BIT( 1 ) ) ? 0 : 0xFFFFFFFF;
-		Table1BPP[ i ][ 7 ] = ( i & BIT( 0 ) ) ? 0 : 0xFFFFFFFF;	
-	}	
-}
-
-#if vMacScreenDepth == 3
-/*
- * Sets up the 8bpp->16bpp paletted to RGBA8 conversion table.
- */
-void MakeTable8BPP( u16* Reds, u16* Greens, u16* Blues ) {
-    int i = 0;
-    
-    for ( i = 0; i < 256; i++ ) {
-		Table8BPP[ i ] = RGBA8( Reds[ i ] >> 8, Greens[ i ] >> 8, Blues[ i ] >> 8, 0xFF );
-    }
-}
-
-/*
- * Converts an 8bpp paletted image and outputs it in RGBA8 format.
- */
-static void Convert8BPP( u8* Src, u32* Dest, int Size ) {
-    while ( Size-- ) {
-        *Dest++ = Table8BPP[ *Src++ ];
-    }
-}
-#endif
-
-#if vMacScreenDepth == 2
-/*
- * Sets up the 4bpp->16bpp paletted to RGBA8 conversion table.
- */
-void MakeTable4BPP( u16* Reds, u16* Greens, u16* Blues ) {
-	int r, g, b, l, h, i = 0;
-	u32* Ptr = NULL;
-	
-	for ( i = 0; i < 256; i++ ) {
-		l = i >> 4;
-		h = i & 0x0F;
-		
-		Ptr = ( u32* ) &Table4BPP[ i ];
-		
-		r = ( Reds[ h ] >> 8 ) & 0xFF;
-		g = ( Greens[ h ] >> 8 ) & 0xFF;
-		b = ( Blues[ h ] >> 8 ) & 0xFF;
-		
-		Ptr[ 1 ] = RGBA8( r, g, b, 0xFF );
-		
-		r = ( Reds[ l ] >> 8 ) & 0xFF;
-		g = ( Greens[ l ] >> 8 ) & 0xFF;
-		b = ( Blues[ l ] >> 8 ) & 0xFF;
-		
-		Ptr[ 0 ] = RGBA8( r, g, b, 0xFF );
-	}
-}
-
-/*
- * Converts an 4bpp packed image and outputs it in RGBA8 format.
- */
-static void Convert4BPP( u8* Src, u64* Dest, int Size ) {
-	do {
-		*Dest++ = Table4BPP[ *Src++ ];
-		Size-= 2;
-	}
-	while ( Size > 0 );
-}
-#endif
+/* Tables and kernels that convert the screen into the staging buffer */
+#include "SCRNCNVT.h"
+LOCALVAR blnr Table1BPPValid = falseblnr;
 
 void Video_UpdateTexture( u8* Src, int Left, int Right, int Top, int Bottom ) {
-	u32* TempBuffer = ( u32* ) TempTextureBuffer;
+	fbpixel* TempBuffer = TempTextureBuffer;
 	int Offset = 0;
 	int Depth = 0;
 	static u32 Longest = 0;
@@ -467,26 +440,39 @@ void Video_UpdateTexture( u8* Src, int Left, int Right, int Top, int Bottom ) {
 		/* 1BPP: Make sure Left and Right are on an 8 pixel boundary */
 		Left = ( int ) ( ( unsigned int ) Left & ~0x07 );
 		Right = ( int ) ( ( unsigned int ) ( Right + 8 ) & ~0x07 );
+	} else if ( Depth == 2 ) {
+		/* 2BPP: Align to a 4 pixel boundary */
+		Left = ( Left & ~3 );
+		Right = ( Right + 3 ) & ~3;
 	} else if ( Depth == 4 ) {
 		// 4BPP: Align to a 2pixel boundary */
 		Left = ( Left & ~1 );
 		Right = ( Right + 1 ) & ~1;
 	}
 
-#if vMacScreenDepth == 0
-	MakeTable1BPP( );
+	/*
+	 * The 1bpp table never changes. The palette tables only need
+	 * rebuilding when the CLUT or the color mode changes, which
+	 * ScreenFindChanges reports by clearing ColorTransValid.
+	 */
+	if ( ! Table1BPPValid ) {
+		MakeTable1BPP( );
+		Table1BPPValid = trueblnr;
+	}
+
+#if vMacScreenDepth > 3
+	#error Bit depth unsupported (yet/at all)
+#elif vMacScreenDepth != 0
+	if ( UseColorMode && ! ColorTransValid ) {
+#if vMacScreenDepth == 1
+		MakeTable2BPP( CLUT_reds, CLUT_greens, CLUT_blues );
 #elif vMacScreenDepth == 2
-	if ( UseColorMode == trueblnr )
 		MakeTable4BPP( CLUT_reds, CLUT_greens, CLUT_blues );
-	else
-		MakeTable1BPP( );
-#elif vMacScreenDepth == 3
-	if ( UseColorMode == trueblnr )
-		MakeTable8BPP( CLUT_reds, CLUT_greens, CLUT_blues );
-	else
-		MakeTable1BPP( );
 #else
-	#error Bit depth unsupported (yet/at all)
+		MakeTable8BPP( CLUT_reds, CLUT_greens, CLUT_blues );
+#endif
+		ColorTransValid = trueblnr;
+	}
 #endif
 
 	if ( Left < 0 ) Left = 0;
@@ -501,15 +487,19 @@ void Video_UpdateTexture( u8* Src, int Left, int Right, int Top, int Bottom ) {
 	if ( Bottom < 0 ) Bottom = 0;
 	if ( Bottom > vMacScreenHeight ) Bottom = vMacScreenHeight;
 	
+	ScrnTile_NoteRows( Top, Bottom );
+	
 	for ( ; Top < Bottom; Top++ ) {
-		TempBuffer = &( ( u32* ) TempTextureBuffer )[ ( ( Top * 512 ) + Left ) ];
+		TempBuffer = &TempTextureBuffer[ ( ( Top * 512 ) + Left ) ];
 		Offset = ( ( Top * vMacScreenWidth ) / ( 8 / Depth ) ) + ( Left / ( 8 / Depth ) );
 
 		if ( Depth == 1 ) {
 			Convert1BPP( &Src[ Offset ], TempBuffer, ( Right - Left ) );
 		} else {
-#if vMacScreenDepth == 2
-			Convert4BPP( &Src[ Offset ], ( u64* ) TempBuffer, ( Right - Left ) );
+#if vMacScreenDepth == 1
+			Convert2BPP( &Src[ Offset ], TempBuffer, ( Right - Left ) );
+#elif vMacScreenDepth == 2
+			Convert4BPP( &Src[ Offset ], ( fbpixel2* ) TempBuffer, ( Right - Left ) );
 #elif vMacScreenDepth == 3
 			Convert8BPP( &Src[ Offset ], TempBuffer, ( Right - Left ) );
 #endif
@@ -1288,7 +1278,7 @@ static int Video_SetupShader( void ) {
 static int Video_CreateTextures( void ) {
     C3D_TexEnv* Env = NULL;
     
-    C3D_TexInit( &FBTexture, 512, 512, GPU_RGBA8 );
+    C3D_TexInit( &FBTexture, 512, 512, FBTEXTURE_GPU_FORMAT );
     C3D_TexInit( &KeyboardTex, 512, 256, GPU_RGBA8 );
     C3D_TexInit( &FontTex, FontTex_Width, FontTex_Height, GPU_RGBA8 );
     
@@ -1492,7 +1482,14 @@ int Video_Init( void ) {
     
     C3D_DepthTest( true, GPU_GEQUAL, GPU_WRITE_ALL );
     
-    TempTextureBuffer = ( u32* ) linearMemAlign( 512 * 512 * 4, 0x80 );
+    TempTextureBuffer = ( fbpixel* ) linearMemAlign( FBTextureBytes, 0x80 );
+    
+    if ( TempTextureBuffer ) {
+        /* The first upload covers the whole texture, off screen rows too */
+        memset( TempTextureBuffer, 0, FBTextureBytes );
+        ScrnTile_NoteAll( );
+        FBTextureNeedsUpdate = trueblnr;
+    }
     
 #ifdef DEBUG_CONSOLE
     DebugConsoleInit( );
@@ -1636,6 +1633,37 @@ LOCALPROC NativeStrFromCStr(char *r, char *s)
 
 LOCALVAR FILE *Drives[NumDrives]; /* open disk image files */
 
+/*
+	Disk images no bigger than DiskPreloadMaxSize are read
+	into memory when inserted, so that transfers are just
+	a memcpy instead of a seek and a read through the
+	SD card. Writes are kept in memory, and the range that
+	has been written to is put back into the file on eject.
+	Set DiskPreloadMaxSize to 0 to always use the file.
+*/
+
+#ifndef DiskPreloadMaxSize
+#define DiskPreloadMaxSize (1440UL * 1024UL)
+#endif
+
+#define WantDiskPreload (0 != DiskPreloadMaxSize)
+
+#if WantDiskPreload
+LOCALVAR ui3p DriveImage[NumDrives]; /* preloaded contents, or null */
+LOCALVAR ui5r DriveImageSize[NumDrives];
+LOCALVAR ui5r DriveDirtyStart[NumDrives];
+LOCALVAR ui5r DriveDirtyEnd[NumDrives];
+	/* nothing to write back if DriveDirtyEnd <= DriveDirtyStart */
+#endif
+
+#include "DGLUCMPR.h"
+
+LOCALFUNC tMacErr vSonyTransfer0(blnr IsWrite, ui3p Buffer,
+	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
+	ui5r *Sony_ActCount);
+
+#include "DGLUOVRL.h"
+
 LOCALPROC InitDrives(void)
 {
 	/*
@@ -1646,10 +1674,120 @@ LOCALPROC InitDrives(void)
 
 	for (i = 0; i < NumDrives; ++i) {
 		Drives[i] = NotAfileRef;
+		CmpDsks[i] = nullpr;
+		OvlDsks[i] = nullpr;
+#if WantDiskPreload
+		DriveImage[i] = nullpr;
+#endif
 	}
 }
 
-GLOBALFUNC tMacErr vSonyTransfer(blnr IsWrite, ui3p Buffer,
+#if WantDiskPreload
+LOCALFUNC tMacErr vSonyTransferPreloaded(blnr IsWrite, ui3p Buffer,
+	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
+	ui5r *Sony_ActCount)
+{
+	tMacErr err = mnvm_miscErr;
+	ui5r L = DriveImageSize[Drive_No];
+	ui5r NewSony_Count = 0;
+
+	if (Sony_Start <= L) {
+		NewSony_Count = L - Sony_Start;
+		if (NewSony_Count >= Sony_Count) {
+			NewSony_Count = Sony_Count;
+			err = mnvm_noErr;
+		}
+
+		if (IsWrite) {
+			MyMoveBytes((anyp)Buffer,
+				(anyp)(DriveImage[Drive_No] + Sony_Start),
+				NewSony_Count);
+
+			if (0 != NewSony_Count) {
+				if (DriveDirtyEnd[Drive_No] <= DriveDirtyStart[Drive_No])
+				{
+					DriveDirtyStart[Drive_No] = Sony_Start;
+					DriveDirtyEnd[Drive_No] =
+						Sony_Start + NewSony_Count;
+				} else {
+					if (Sony_Start < DriveDirtyStart[Drive_No]) {
+						DriveDirtyStart[Drive_No] = Sony_Start;
+					}
+					if (Sony_Start + NewSony_Count
+						> DriveDirtyEnd[Drive_No])
+					{
+						DriveDirtyEnd[Drive_No] =
+							Sony_Start + NewSony_Count;
+					}
+				}
+			}
+		} else {
+			MyMoveBytes((anyp)(DriveImage[Drive_No] + Sony_Start),
+				(anyp)Buffer, NewSony_Count);
+		}
+	}
+
+	if (nullpr != Sony_ActCount) {
+		*Sony_ActCount = NewSony_Count;
+	}
+
+	return err;
+}
+#endif
+
+#if WantDiskPreload
+LOCALPROC DriveWriteBackPreloaded(tDrive Drive_No)
+{
+	ui5r Start = DriveDirtyStart[Drive_No];
+	ui5r End = DriveDirtyEnd[Drive_No];
+	FILE *refnum = Drives[Drive_No];
+
+	if (End > Start) {
+		if ((0 != fseek(refnum, Start, SEEK_SET))
+			|| (End - Start != fwrite(DriveImage[Drive_No] + Start,
+				1, End - Start, refnum)))
+		{
+			WriteExtraErr("failed to write back preloaded disk image");
+		}
+		DriveDirtyStart[Drive_No] = 0;
+		DriveDirtyEnd[Drive_No] = 0;
+	}
+}
+#endif
+
+#if WantDiskPreload
+LOCALPROC DrivePreload(tDrive Drive_No)
+{
+	FILE *refnum = Drives[Drive_No];
+	long v;
+	ui3p p;
+
+	/*
+		On any failure just leave DriveImage null, and
+		fall back to going through the file.
+	*/
+	if (0 == fseek(refnum, 0, SEEK_END)) {
+		v = ftell(refnum);
+		if ((v > 0) && ((ui5r)v <= DiskPreloadMaxSize)) {
+			p = (ui3p)malloc(v);
+			if (NULL != p) {
+				if ((0 == fseek(refnum, 0, SEEK_SET))
+					&& ((size_t)v == fread(p, 1, v, refnum)))
+				{
+					DriveImage[Drive_No] = p;
+					DriveImageSize[Drive_No] = v;
+					DriveDirtyStart[Drive_No] = 0;
+					DriveDirtyEnd[Drive_No] = 0;
+				} else {
+					free(p);
+				}
+			}
+		}
+	}
+}
+#endif
+
+LOCALFUNC tMacErr vSonyTransfer0(blnr IsWrite, ui3p Buffer,
 	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
 	ui5r *Sony_ActCount)
 {
@@ -1657,6 +1795,18 @@ GLOBALFUNC tMacErr vSonyTransfer(blnr IsWrite, ui3p Buffer,
 	FILE *refnum = Drives[Drive_No];
 	ui5r NewSony_Count = 0;
 
+	if (CmpDskIsCompressed(Drive_No)) {
+		return CmpDskTransfer(IsWrite, Buffer, Drive_No,
+			Sony_Start, Sony_Count, Sony_ActCount);
+	}
+
+#if WantDiskPreload
+	if (nullpr != DriveImage[Drive_No]) {
+		return vSonyTransferPreloaded(IsWrite, Buffer, Drive_No,
+			Sony_Start, Sony_Count, Sony_ActCount);
+	}
+#endif
+
 	if (0 == fseek(refnum, Sony_Start, SEEK_SET)) {
 		if (IsWrite) {
 			NewSony_Count = fwrite(Buffer, 1, Sony_Count, refnum);
@@ -1682,6 +1832,18 @@ GLOBALFUNC tMacErr vSonyGetSize(tDrive Drive_No, ui5r *Sony_Count)
 	FILE *refnum = Drives[Drive_No];
 	long v;
 
+	if (CmpDskIsCompressed(Drive_No)) {
+		*Sony_Count = CmpDsks[Drive_No]->ImageSize;
+		return mnvm_noErr;
+	}
+
+#if WantDiskPreload
+	if (nullpr != DriveImage[Drive_No]) {
+		*Sony_Count = DriveImageSize[Drive_No];
+		return mnvm_noErr;
+	}
+#endif
+
 	if (0 == fseek(refnum, 0, SEEK_END)) {
 		v = ftell(refnum);
 		if (v >= 0) {
@@ -1693,16 +1855,46 @@ GLOBALFUNC tMacErr vSonyGetSize(tDrive Drive_No, ui5r *Sony_Count)
 	return err; /*& figure out what really to return &*/
 }
 
+GLOBALFUNC tMacErr vSonyTransfer(blnr IsWrite, ui3p Buffer,
+	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
+	ui5r *Sony_ActCount)
+{
+	if (OvlDskIsOverlaid(Drive_No)) {
+		return OvlDskTransfer(IsWrite, Buffer, Drive_No,
+			Sony_Start, Sony_Count, Sony_ActCount);
+	}
+
+	return vSonyTransfer0(IsWrite, Buffer, Drive_No,
+		Sony_Start, Sony_Count, Sony_ActCount);
+}
+
 LOCALFUNC tMacErr vSonyEject0(tDrive Drive_No, blnr deleteit)
 {
 	FILE *refnum = Drives[Drive_No];
+	tMacErr err = mnvm_noErr;
 
 	DiskEjectedNotify(Drive_No);
 
+	if (OvlDskIsOverlaid(Drive_No)) {
+		OvlDskClose(Drive_No);
+	}
+
+	if (CmpDskIsCompressed(Drive_No)) {
+		err = CmpDskClose(Drive_No);
+	}
+
+#if WantDiskPreload
+	if (nullpr != DriveImage[Drive_No]) {
+		DriveWriteBackPreloaded(Drive_No);
+		free(DriveImage[Drive_No]);
+		DriveImage[Drive_No] = nullpr;
+	}
+#endif
+
 	fclose(refnum);
 	Drives[Drive_No] = NotAfileRef; /* not really needed */
 
-	return mnvm_noErr;
+	return err;
 }
 
 GLOBALFUNC tMacErr vSonyEject(tDrive Drive_No)
@@ -1719,6 +1911,8 @@ LOCALPROC UnInitDrives(void)
 			(void) vSonyEject(i);
 		}
 	}
+
+	CmpDskUnInit();
 }
 
 LOCALFUNC blnr Sony_Insert0(FILE *refnum, blnr locked,
@@ -1734,9 +1928,26 @@ LOCALFUNC blnr Sony_Insert0(FILE *refnum, blnr locked,
 		/* printf("Sony_Insert0 %d\n", (int)Drive_No); */
 		{
 			Drives[Drive_No] = refnum;
-			DiskInsertNotify(Drive_No, locked);
+			if (! CmpDskOpen(Drive_No)) {
+				MacMsg(kStrOpenFailTitle, kStrOpenFailMessage,
+					falseblnr);
+			} else {
+#if WantDiskPreload
+				if (! CmpDskIsCompressed(Drive_No)) {
+					DrivePreload(Drive_No);
+				}
+#endif
+				if (! OvlDskOpen(Drive_No, drivepath, locked)) {
+					/* don't let writes reach a shared image */
+					locked = trueblnr;
+				} else if (OvlDskIsOverlaid(Drive_No)) {
+					/* writes go to the overlay */
+					locked = falseblnr;
+				}
+				DiskInsertNotify(Drive_No, locked);
 
-			IsOk = trueblnr;
+				IsOk = trueblnr;
+			}
 		}
 	}
 
@@ -1874,6 +2085,12 @@ LOCALPROC HaveChangedScreenBuff(ui4r top, ui4r left,
 
 LOCALPROC MyDrawChangesAndClear(void)
 {
+#if ScreenWriteTracked
+	if (nullpr == screencomparebuff) {
+		/* no frame output yet */
+		return;
+	}
+#endif
 	if (ScreenChangedBottom > ScreenChangedTop) {
 		HaveChangedScreenBuff(ScreenChangedTop, ScreenChangedLeft,
 			ScreenChangedBottom, ScreenChangedRight);
@@ -1881,6 +2098,99 @@ LOCALPROC MyDrawChangesAndClear(void)
 	}
 }
 
+GLOBALOSGLUFUNC ui5r GetMicroseconds( void ) {
+	return ( ui5r ) ( svcGetSystemTick( ) / ( SYSCLOCK_ARM11 / 1000000 ) );
+}
+
+#ifndef EnableFramePacer
+#define EnableFramePacer 1
+#endif
+
+#if EnableFramePacer
+
+#define dbglog_FramePacer (1 && dbglog_HAVE)
+
+#include "FRMPACER.h"
+
+LOCALVAR blnr FramePacerInTick = falseblnr;
+LOCALVAR ui5r FramePacerTickStart = 0;
+
+/* draw at most MaxRows rows of the changes, the rest wait */
+LOCALPROC MyDrawSomeChanges(ui5r MaxRows)
+{
+	si4b Bottom = ScreenChangedTop + MaxRows;
+
+	if (Bottom >= ScreenChangedBottom) {
+		MyDrawChangesAndClear();
+	} else {
+#if ScreenWriteTracked
+		if (nullpr == screencomparebuff) {
+			return;
+		}
+#endif
+		HaveChangedScreenBuff(ScreenChangedTop, ScreenChangedLeft,
+			Bottom, ScreenChangedRight);
+		ScreenChangedTop = Bottom;
+	}
+}
+
+LOCALPROC MyPacedDrawChanges(void)
+{
+	ui5r Now = GetMicroseconds();
+	ui5r Elapsed = Now - FramePacerTickStart;
+	ui5r Rows;
+	ui5r RowsToDraw = 0;
+
+	FramePacer_NoteEmu(Elapsed);
+
+	if (ScreenChangedBottom > ScreenChangedTop) {
+		Rows = ScreenChangedBottom - ScreenChangedTop;
+		switch (FramePacer_Decide(Elapsed, Rows, &RowsToDraw)) {
+			case kFramePacerFull:
+				RowsToDraw = Rows;
+				break;
+			case kFramePacerSkip:
+				RowsToDraw = 0;
+				break;
+			case kFramePacerPartial:
+			default:
+				break;
+		}
+
+		if (RowsToDraw > 0) {
+			MyDrawSomeChanges(RowsToDraw);
+			FramePacer_NoteDraw(GetMicroseconds() - Now,
+				(RowsToDraw < Rows) ? RowsToDraw : Rows);
+		}
+	}
+}
+
+#if dbglog_FramePacer
+LOCALPROC FramePacer_dbglog(void)
+{
+	int i;
+
+	dbglog_writelnNum("FramePacer emu us",
+		FramePacer_Avg(FramePacer.EmuCost8));
+	dbglog_writelnNum("FramePacer row 16ths of us",
+		FramePacer_Avg(FramePacer.RowCost8));
+	dbglog_writelnNum("FramePacer present us",
+		FramePacer_Avg(FramePacer.PresentCost8));
+	dbglog_writelnNum("FramePacer full",
+		FramePacer.Decisions[kFramePacerFull]);
+	dbglog_writelnNum("FramePacer partial",
+		FramePacer.Decisions[kFramePacerPartial]);
+	dbglog_writelnNum("FramePacer skip",
+		FramePacer.Decisions[kFramePacerSkip]);
+	for (i = 0; i < kFramePacerHistN; ++i) {
+		dbglog_writelnNum("FramePacer tick time bucket",
+			FramePacer.Hist[i]);
+	}
+}
+#endif
+
+#endif /* EnableFramePacer */
+
 GLOBALPROC DoneWithDrawingForTick(void)
 {
 #if EnableMouseMotion && MayFullScreen
@@ -1888,7 +2198,16 @@ GLOBALPROC DoneWithDrawingForTick(void)
 		AutoScrollScreen();
 	}
 #endif
-	MyDrawChangesAndClear();
+#if EnableFramePacer
+	if (FramePacerInTick) {
+		/* first tick since WaitForNextTick, the pacer decides */
+		FramePacerInTick = falseblnr;
+		MyPacedDrawChanges();
+	} else
+#endif
+	{
+		MyDrawChangesAndClear();
+	}
 }
 
 /* --- mouse --- */
@@ -2926,6 +3245,19 @@ LOCALPROC MySound_WroteABlock(void)
 	//dbglog_writenow("enter MySound_WroteABlock");
 #endif
 
+#if EnableAutoTurbo
+	if (AutoTurboActive) {
+		/* running too fast for the sound to mean anything */
+		tpSoundSamp q = TheSoundBuffer
+			+ ((TheWriteOffset - kOneBuffLen) & kAllBuffMask);
+		int i;
+
+		for (i = kOneBuffLen; --i >= 0; ) {
+			*q++ = kCenterSound;
+		}
+	}
+#endif
+
 	ConvertSoundBlockToNative(p);
 
 	TheFillOffset = TheWriteOffset;
@@ -2962,9 +3294,83 @@ LOCALFUNC blnr MySound_EndWrite0(ui4r actL)
 	return v;
 }
 
+#define SOUND_SAMPLERATE 22255 /*= round(7833600 * 2 / 704) */
+#define SampleCount 1024
+
+#ifndef SoundRatePLL
+#define SoundRatePLL 1
+#endif
+
+#if SoundRatePLL
+/*
+	Instead of nudging the emulated time to suit the sound
+	hardware, the rate NDSP plays the guest samples at is
+	steered so that the amount buffered stays near
+	kSoundTargetFill. NDSP's polyphase filter does the
+	conversion to the output rate, so this costs nearly
+	nothing here. The correction is kept within
+	kSoundMaxPPM, far too small to hear as a pitch change.
+*/
+
+#define kSoundTargetFill (6 * kOneBuffLen)
+#define kSoundMaxPPM 5000
+#define kSoundPLLKp 2 /* ppm per sample of error */
+#define kSoundPLLKiShift 5 /* integral term divisor, as a shift */
+
+LOCALVAR si5b SoundFillAvg16 = kSoundTargetFill << 4;
+LOCALVAR si5b SoundPLLInteg = 0;
+LOCALVAR si5b SoundRatePPM = 0;
+
+LOCALPROC SoundRatePLL_Reset(void)
+{
+	SoundFillAvg16 = kSoundTargetFill << 4;
+	SoundPLLInteg = 0;
+	SoundRatePPM = 0;
+	ndspChnSetRate( 0, SOUND_SAMPLERATE );
+}
+
+/* called each time NDSP wants another buffer, with the fill level */
+LOCALPROC SoundRatePLL_Update(ui4b ToPlayLen)
+{
+	si5b err;
+	si5b ppm;
+	si5b IntegMax = (si5b)kSoundMaxPPM << kSoundPLLKiShift;
+
+	/* smooth out the steps from whole blocks coming and going */
+	SoundFillAvg16 += (((si5b)ToPlayLen << 4) - SoundFillAvg16) >> 3;
+	err = (SoundFillAvg16 >> 4) - kSoundTargetFill;
+
+	SoundPLLInteg += err;
+	if (SoundPLLInteg > IntegMax) {
+		SoundPLLInteg = IntegMax;
+	} else if (SoundPLLInteg < - IntegMax) {
+		SoundPLLInteg = - IntegMax;
+	}
+
+	/* too full means play faster */
+	ppm = err * kSoundPLLKp + (SoundPLLInteg >> kSoundPLLKiShift);
+	if (ppm > kSoundMaxPPM) {
+		ppm = kSoundMaxPPM;
+	} else if (ppm < - kSoundMaxPPM) {
+		ppm = - kSoundMaxPPM;
+	}
+
+	if (ppm != SoundRatePPM) {
+		SoundRatePPM = ppm;
+		ndspChnSetRate( 0, SOUND_SAMPLERATE * ( 1.0f + ( ppm * 1e-6f ) ) );
+	}
+}
+#endif
+
 LOCALPROC MySound_SecondNotify0(void)
 {
 	if (MinFilledSoundBuffs <= kSoundBuffers) {
+#if SoundRatePLL
+		/* SoundRatePLL_Update keeps the buffers filled */
+#if dbglog_SoundStuff
+		dbglog_writenow("SoundRatePPM %d", (int)SoundRatePPM);
+#endif
+#else
 		if (MinFilledSoundBuffs > DesiredMinFilledSoundBuffs) {
 #if dbglog_SoundStuff
 			dbglog_writenow("MinFilledSoundBuffs too high");
@@ -2976,6 +3382,7 @@ LOCALPROC MySound_SecondNotify0(void)
 #endif
 			++TrueEmulatedTime;
 		}
+#endif
 #if dbglog_SoundBuffStats
 		dbglog_writenow("MinFilledSoundBuffs %d",
 			MinFilledSoundBuffs);
@@ -3077,6 +3484,12 @@ static void my_audio_callback(void *udata, u8 *stream, int len)
 	//dbglog_writelnNum("len", len);
 #endif
 
+#if SoundRatePLL
+	if (datp->HaveStartedPlaying) {
+		SoundRatePLL_Update(*datp->fFillOffset - CurPlayOffset);
+	}
+#endif
+
 label_retry:
 	ToPlayLen = *datp->fFillOffset - CurPlayOffset;
 	FilledSoundBuffs = ToPlayLen >> kLnOneBuffLen;
@@ -3232,9 +3645,6 @@ LOCALPROC MySound_UnInit( void ) {
 	}
 }
 
-#define SOUND_SAMPLERATE 22255 /*= round(7833600 * 2 / 704) */
-#define SampleCount 1024
-
 LOCALPROC DSPThreadCallback( void* Param ) {
 	if ( HaveSoundOut == trueblnr ) {
 		if ( DSPWaveBufs[ CurrentWaveBuf ].status == NDSP_WBUF_DONE ) {
@@ -3271,8 +3681,13 @@ LOCALFUNC blnr MySound_Init( void ) {
 			memset( DSPWaveBufs, 0, sizeof( DSPWaveBufs ) );
 			
 			ndspSetOutputMode( NDSP_OUTPUT_MONO );
+#if SoundRatePLL
+			ndspChnSetInterp( 0, NDSP_INTERP_POLYPHASE );
+			SoundRatePLL_Reset( );
+#else
 			ndspChnSetInterp( 0, NDSP_INTERP_LINEAR );
 			ndspChnSetRate( 0, SOUND_SAMPLERATE );
+#endif
 			ndspChnSetFormat( 0, NDSP_FORMAT_MONO_PCM16 );
 			ndspChnSetMix( 0, Mix );
 			
@@ -3592,10 +4007,31 @@ LOCALPROC UpdateScreenScroll( void ) {
     }
 }
 
+/*
+ * Uploads the dirty bands of the staging buffer.
+ * The transfer flips vertically, so source rows Top to Bottom land in
+ * texture rows 512 - Bottom to 512 - Top, and since they are whole
+ * 8 row bands they are also whole rows of tiles in the texture.
+ */
 LOCALPROC UpdateFBTexture( void ) {
+	ScrnTileSpan Spans[ kScrnTileMaxSpans ];
+	fbpixel* Src = NULL;
+	fbpixel* Dest = NULL;
+	int Rows = 0;
+	int Count = 0;
+	int i = 0;
+	
 	if ( FBTextureNeedsUpdate == trueblnr ) {
-		GSPGPU_FlushDataCache( TempTextureBuffer, 512 * 512 * 4 );
-		GX_DisplayTransfer( ( u32* ) TempTextureBuffer, GX_BUFFER_DIM( 512, 512 ), ( u32* ) FBTexture.data, GX_BUFFER_DIM( 512, 512 ), TEXTURE32_TRANSFER_FLAGS );
+		Count = ScrnTile_TakeSpans( Spans, kScrnTileMaxSpans );
+		
+		for ( i = 0; i < Count; i++ ) {
+			Rows = Spans[ i ].Bottom - Spans[ i ].Top;
+			Src = &TempTextureBuffer[ Spans[ i ].Top * 512 ];
+			Dest = &( ( fbpixel* ) FBTexture.data )[ ( 512 - Spans[ i ].Bottom ) * 512 ];
+			
+			GSPGPU_FlushDataCache( Src, Rows * 512 * sizeof( fbpixel ) );
+			GX_DisplayTransfer( ( u32* ) Src, GX_BUFFER_DIM( 512, Rows ), ( u32* ) Dest, GX_BUFFER_DIM( 512, Rows ), FBTEXTURE_TRANSFER_FLAGS );
+		}
 	
 		FBTextureNeedsUpdate = falseblnr;
 	}
@@ -3651,6 +4087,9 @@ LOCALPROC HandleTheEvent( void ) {
 	char Buffer[ 256 ];
 	static int FPS = 0;
 	static int i = 0;
+#if EnableFramePacer
+	ui5r PresentStart = 0;
+#endif
 
     if ( aptMainLoop( ) ) {
 		if ( ++i == 60 ) {
@@ -3692,6 +4131,9 @@ LOCALPROC HandleTheEvent( void ) {
 			KeyboardHandle3DSKeyBinds( );
         
         UpdateScreenScroll( );
+#if EnableFramePacer
+		PresentStart = GetMicroseconds( );
+#endif
 		UpdateFBTexture( );
 		
 #ifdef DEBUG_CONSOLE
@@ -3707,6 +4149,9 @@ LOCALPROC HandleTheEvent( void ) {
         		DrawSubScreen( );
         	C3D_FrameEnd( 0 );
 		}
+#if EnableFramePacer
+		FramePacer_NotePresent( GetMicroseconds( ) - PresentStart );
+#endif
     } else {
         /* If we're force closing, make sure the emulator exits.
          */
@@ -3898,8 +4343,56 @@ LOCALPROC CheckForSavedTasks(void)
 
 /* --- command line parsing --- */
 
+/* such as "4M", "2.5M" or "512K" */
+LOCALFUNC blnr ParseRAMSize(char *s, ui5r *r)
+{
+	ui5r n = 0;
+	ui5r tenths = 0;
+
+	if ((*s < '0') || (*s > '9')) {
+		return falseblnr;
+	}
+	while ((*s >= '0') && (*s <= '9')) {
+		n = n * 10 + (*s++ - '0');
+	}
+	if (('.' == *s) && (s[1] >= '0') && (s[1] <= '9')) {
+		tenths = s[1] - '0';
+		s += 2;
+	}
+	if (('M' == *s) || ('m' == *s)) {
+		n = (n << 20) + ((tenths << 20) / 10);
+		++s;
+	} else if (('K' == *s) || ('k' == *s)) {
+		n = (n << 10) + ((tenths << 10) / 10);
+		++s;
+	}
+	if (0 != *s) {
+		return falseblnr;
+	}
+	*r = n;
+
+	return trueblnr;
+}
+
 LOCALFUNC blnr ScanCommandLine(void)
 {
+	char *pa;
+	int i = 1;
+
+label_retry:
+	if (i < my_argc) {
+		pa = my_argv[i++];
+		if (((0 == strcmp(pa, "--ram")) || (0 == strcmp(pa, "-m")))
+			&& (i < my_argc)
+			&& ParseRAMSize(my_argv[i], &RAMSizeRequest))
+		{
+			++i;
+		} else {
+			MacMsg(kStrBadArgTitle, kStrBadArgMessage, falseblnr);
+		}
+		goto label_retry;
+	}
+
 	return trueblnr;
 }
 
@@ -3947,6 +4440,11 @@ label_retry:
 #endif
 #if EnableDemoMsg
 		DemoModeSecondNotify();
+#endif
+#if EnableFramePacer && dbglog_FramePacer
+		if (0 == (CurMacDateInSeconds % 10)) {
+			FramePacer_dbglog();
+		}
 #endif
 	}
 
@@ -3961,6 +4459,18 @@ label_retry:
 
 	OnTrueTime = TrueEmulatedTime;
 
+#if EnableFramePacer
+	{
+		ui5r Now = GetMicroseconds();
+
+		if (0 != FramePacerTickStart) {
+			FramePacer_NoteTickTime(Now - FramePacerTickStart);
+		}
+		FramePacerTickStart = Now;
+		FramePacerInTick = trueblnr;
+	}
+#endif
+
 #if dbglog_TimeStuff
 	dbglog_writelnNum("WaitForNextTick, OnTrueTime", OnTrueTime);
 #endif
@@ -3983,8 +4493,10 @@ LOCALPROC ReserveAllocAll(void)
 #endif
 	ReserveAllocOneBlock(&ROM, kROM_Size, 5, falseblnr);
 
+#if ! ScreenWriteTracked
 	ReserveAllocOneBlock(&screencomparebuff,
 		vMacScreenNumBytes, 5, trueblnr);
+#endif
 #if UseControlKeys
 	ReserveAllocOneBlock(&CntrlDisplayBuff,
 		vMacScreenNumBytes, 5, falseblnr);
@@ -4050,17 +4562,20 @@ LOCALFUNC blnr InitOSGLU(void)
 
     if ( Video_Init( ) )
     if ( Keyboard_Init( ) )
+	if (ScanCommandLine()) /* before the RAM size is needed */
 	if (AllocMyMemory())
 #if dbglog_HAVE
 	if (dbglog_open())
 #endif
-	if (ScanCommandLine())
 	if (LoadInitialImages())
 	if (LoadMacRom())
     if ( InitTouchKeyToMac( ) )
 	if (InitLocationDat())
 #if MySoundEnabled
 	if (MySound_Init())
+#endif
+#if EmLocalTalk
+	if (InitLocalTalk())
 #endif
 	if (Screen_Init())
 	if (CreateMainWindow())
@@ -4088,6 +4603,9 @@ LOCALPROC UnInitOSGLU(void)
 #if MySoundEnabled
 	MySound_UnInit();
 #endif
+#if EmLocalTalk
+	UnInitLocalTalk();
+#endif
 #if IncludePbufs
 	UnInitPbufs();
 #endif
@@ -536,6 +536,23 @@ LOCALVAR const ui3r SubTick_n[kNumSubTicks] = {
 	23,  23,  23,  23,  23,  23,  23,  24
 };
 
+/* how many of the first n samples a FIFO can supply */
+LOCALFUNC ui4r ASC_FIFO_Avail(ui4b FIFO_In, ui4r n)
+{
+	ui4b avail = FIFO_In - ASC_FIFO_Out;
+
+	return (avail < n) ? avail : n;
+}
+
+#if MySoundEnabled
+LOCALPROC ASC_FillSamps(tpSoundSamp p, ui4r n, trSoundSamp v)
+{
+	for (; n > 0; --n) {
+		*p++ = v;
+	}
+}
+#endif
+
 GLOBALPROC ASC_SubTick(int SubTick)
 {
 	ui4r actL;
@@ -543,6 +560,7 @@ GLOBALPROC ASC_SubTick(int SubTick)
 	tpSoundSamp p;
 #endif
 	ui4r i;
+	ui4r m;
 	ui4r n = SubTick_n[SubTick];
 #if MySoundEnabled
 	ui3b SoundVolume = SoundReg_Volume;
@@ -591,28 +609,28 @@ label_retry:
 				}
 			}
 
-			for (i = 0; i < actL; i++) {
-				if (((ui4b)(ASC_FIFO_InA - ASC_FIFO_Out)) == 0) {
-					ASC_Playing = falseblnr;
-				}
-				if (((ui4b)(ASC_FIFO_InB - ASC_FIFO_Out)) == 0) {
+			/*
+				The FIFOs can't be filled while this runs, so
+				play what is there in one go, then silence.
+			*/
+			m = 0;
+			if (ASC_Playing) {
+				m = ASC_FIFO_Avail(ASC_FIFO_InA, actL);
+				m = ASC_FIFO_Avail(ASC_FIFO_InB, m);
+				if (m < actL) {
 					ASC_Playing = falseblnr;
 				}
-				if (! ASC_Playing) {
-#if MySoundEnabled
-					*p++ = 0x80;
-#endif
-				} else
-				{
+			}
 
 #if MySoundEnabled
-				addr = ASC_SampBuff + (ASC_FIFO_Out & 0x3FF);
+			for (i = 0; i < m; i++) {
+				addr = ASC_SampBuff + ((ASC_FIFO_Out + i) & 0x3FF);
 
 #if ASC_dolog && 1
 				dbglog_StartLine();
 				dbglog_writeCStr("out sound ");
 				dbglog_writeCStr("[");
-				dbglog_writeHex(ASC_FIFO_Out);
+				dbglog_writeHex(ASC_FIFO_Out + i);
 				dbglog_writeCStr("]");
 				dbglog_writeCStr(" = ");
 				dbglog_writeHex(*addr);
@@ -626,12 +644,12 @@ label_retry:
 					<< 8
 #endif
 					) >> 1;
+			}
+			ASC_FillSamps(p, actL - m, 0x80);
+			p += actL - m;
 #endif /* MySoundEnabled */
 
-				ASC_FIFO_Out += 1;
-
-				}
-			}
+			ASC_FIFO_Out += m;
 
 			} else {
 
@@ -648,30 +666,29 @@ label_retry:
 				}
 			}
 
-			for (i = 0; i < actL; i++) {
-				if (((ui4b)(ASC_FIFO_InA - ASC_FIFO_Out)) == 0) {
+			m = 0;
+			if (ASC_Playing) {
+				m = ASC_FIFO_Avail(ASC_FIFO_InA, actL);
+				if (m < actL) {
 					ASC_Playing = falseblnr;
 				}
-				if (! ASC_Playing) {
-#if MySoundEnabled
-					*p++ = 0x80;
-#endif
-				} else
-				{
+			}
 
 #if MySoundEnabled
-				addr = ASC_SampBuff + (ASC_FIFO_Out & 0x3FF);
+			for (i = 0; i < m; i++) {
+				addr = ASC_SampBuff + ((ASC_FIFO_Out + i) & 0x3FF);
 
 #if ASC_dolog && 1
 				dbglog_StartLine();
 				dbglog_writeCStr("out sound ");
 				dbglog_writeCStr("[");
-				dbglog_writeHex(ASC_FIFO_Out);
+				dbglog_writeHex(ASC_FIFO_Out + i);
 				dbglog_writeCStr("]");
 				dbglog_writeCStr(" = ");
 				dbglog_writeHex(*addr);
 				dbglog_writeCStr(", in buff: ");
-				dbglog_writeHex((ui4b)(ASC_FIFO_InA - ASC_FIFO_Out));
+				dbglog_writeHex(
+					(ui4b)(ASC_FIFO_InA - ASC_FIFO_Out - i));
 				dbglog_writeReturn();
 #endif
 
@@ -680,15 +697,12 @@ label_retry:
 					<< 8
 #endif
 					;
+			}
+			ASC_FillSamps(p, actL - m, 0x80);
+			p += actL - m;
 #endif /* MySoundEnabled */
 
-				/* Move the address on */
-				/* *addr = 0x80; */
-				/* addr += 2; */
-				ASC_FIFO_Out += 1;
-
-				}
-			}
+			ASC_FIFO_Out += m;
 
 			}
 		} else if (2 == SoundReg801) {
@@ -769,9 +783,8 @@ label_retry:
 			do_put_mem_long(ASC_ChanA[3].phase, phase3);
 		} else {
 #if MySoundEnabled
-			for (i = 0; i < actL; i++) {
-				*p++ = kCenterSound;
-			}
+			ASC_FillSamps(p, actL, kCenterSound);
+			p += actL;
 #endif
 		}
 
@@ -82,6 +82,16 @@ GLOBALVAR blnr WantMacInterrupt = falseblnr;
 
 GLOBALVAR blnr WantMacReset = falseblnr;
 
+GLOBALVAR ui5r RAMSizeRequest = 0;
+
+#if WantTraceRing
+GLOBALVAR blnr WantTraceRingDump = falseblnr;
+#endif
+
+#if WantTrapProfile
+GLOBALVAR blnr WantTrapProfToggle = falseblnr;
+#endif
+
 GLOBALVAR ui3b SpeedValue = WantInitSpeedValue;
 
 #if EnableAutoSlow
@@ -100,6 +110,15 @@ GLOBALVAR ui5r QuietTime = 0;
 GLOBALVAR ui5r QuietSubTicks = 0;
 #endif
 
+#if EnableAutoTurbo
+GLOBALVAR blnr AutoTurboActive = falseblnr;
+GLOBALVAR blnr AutoTurboBooting = trueblnr;
+GLOBALVAR ui5r AutoTurboDiskQuiet = 0;
+GLOBALVAR ui5r AutoTurboInputQuiet = (ui5r)-1;
+GLOBALVAR ui5r AutoTurboTicks = 0;
+GLOBALVAR ui5r AutoTurboSpurts = 0;
+#endif
+
 #ifndef GrabKeysFullScreen
 #define GrabKeysFullScreen 1
 #endif
@@ -226,366 +245,7 @@ LOCALPROC DiskEjectedNotify(tDrive Drive_No)
 	vSonyInsertedMask &= ~ ((ui5b)1 << Drive_No);
 }
 
-/*
-	block type - for operating on multiple ui3b elements
-		at a time.
-*/
-
-#if LittleEndianUnaligned || BigEndianUnaligned
-
-#define uibb ui5b
-#define uibr ui5r
-#define ln2uiblockn 2
-
-#if 0
-#define uibb long long
-#define uibr long long
-#define ln2uiblockn 3
-#endif
-
-#else
-
-#define uibb ui3b
-#define uibr ui3r
-#define ln2uiblockn 0
-
-#endif
-
-#define uiblockn (1 << ln2uiblockn)
-#define ln2uiblockbitsn (3 + ln2uiblockn)
-#define uiblockbitsn (8 * uiblockn)
-
-LOCALFUNC blnr FindFirstChangeInLVecs(uibb *ptr1, uibb *ptr2,
-					uimr L, uimr *j)
-{
-/*
-	find index of first difference
-*/
-	uibb *p1 = ptr1;
-	uibb *p2 = ptr2;
-	uimr i;
-
-	for (i = L; i != 0; --i) {
-		if (*p1++ != *p2++) {
-			--p1;
-			*j = p1 - ptr1;
-			return trueblnr;
-		}
-	}
-	return falseblnr;
-}
-
-LOCALPROC FindLastChangeInLVecs(uibb *ptr1, uibb *ptr2,
-					uimr L, uimr *j)
-{
-/*
-	find index of last difference, assuming there is one
-*/
-	uibb *p1 = ptr1 + L;
-	uibb *p2 = ptr2 + L;
-
-	while (*--p1 == *--p2) {
-	}
-	*j = p1 - ptr1;
-}
-
-LOCALPROC FindLeftRightChangeInLMat(uibb *ptr1, uibb *ptr2,
-	uimr width, uimr top, uimr bottom,
-	uimr *LeftMin0, uibr *LeftMask0,
-	uimr *RightMax0, uibr *RightMask0)
-{
-	uimr i;
-	uimr j;
-	uibb *p1;
-	uibb *p2;
-	uibr x;
-	ui5r offset = top * width;
-	uibb *p10 = (uibb *)ptr1 + offset;
-	uibb *p20 = (uibb *)ptr2 + offset;
-	uimr LeftMin = *LeftMin0;
-	uimr RightMax = *RightMax0;
-	uibr LeftMask = 0;
-	uibr RightMask = 0;
-	for (i = top; i < bottom; ++i) {
-		p1 = p10;
-		p2 = p20;
-		for (j = 0; j < LeftMin; ++j) {
-			x = *p1++ ^ *p2++;
-			if (0 != x) {
-				LeftMin = j;
-				LeftMask = x;
-				goto Label_3;
-			}
-		}
-		LeftMask |= (*p1 ^ *p2);
-Label_3:
-		p1 = p10 + RightMax;
-		p2 = p20 + RightMax;
-		RightMask |= (*p1++ ^ *p2++);
-		for (j = RightMax + 1; j < width; ++j) {
-			x = *p1++ ^ *p2++;
-			if (0 != x) {
-				RightMax = j;
-				RightMask = x;
-			}
-		}
-
-		p10 += width;
-		p20 += width;
-	}
-	*LeftMin0 = LeftMin;
-	*RightMax0 = RightMax;
-	*LeftMask0 = LeftMask;
-	*RightMask0 = RightMask;
-}
-
-LOCALVAR ui3p screencomparebuff = nullpr;
-
-LOCALVAR uimr NextDrawRow = 0;
-
-
-#if BigEndianUnaligned
-
-#define FlipCheckMonoBits (uiblockbitsn - 1)
-
-#else
-
-#define FlipCheckMonoBits 7
-
-#endif
-
-#define FlipCheckBits (FlipCheckMonoBits >> vMacScreenDepth)
-
-#ifndef WantColorTransValid
-#define WantColorTransValid 0
-#endif
-
-#if WantColorTransValid
-LOCALVAR blnr ColorTransValid = falseblnr;
-#endif
-
-LOCALFUNC blnr ScreenFindChanges(ui3p screencurrentbuff,
-	si3b TimeAdjust, si4b *top, si4b *left, si4b *bottom, si4b *right)
-{
-	uimr j0;
-	uimr j1;
-	uimr j0h;
-	uimr j1h;
-	uimr j0v;
-	uimr j1v;
-	uimr copysize;
-	uimr copyoffset;
-	uimr copyrows;
-	uimr LimitDrawRow;
-	uimr MaxRowsDrawnPerTick;
-	uimr LeftMin;
-	uimr RightMax;
-	uibr LeftMask;
-	uibr RightMask;
-	int j;
-
-	if (TimeAdjust < 4) {
-		MaxRowsDrawnPerTick = vMacScreenHeight;
-	} else if (TimeAdjust < 6) {
-		MaxRowsDrawnPerTick = vMacScreenHeight / 2;
-	} else {
-		MaxRowsDrawnPerTick = vMacScreenHeight / 4;
-	}
-
-#if 0 != vMacScreenDepth
-	if (UseColorMode) {
-		if (ColorMappingChanged) {
-			ColorMappingChanged = falseblnr;
-			j0h = 0;
-			j1h = vMacScreenWidth;
-			j0v = 0;
-			j1v = vMacScreenHeight;
-#if WantColorTransValid
-			ColorTransValid = falseblnr;
-#endif
-		} else {
-			if (! FindFirstChangeInLVecs(
-				(uibb *)screencurrentbuff
-					+ NextDrawRow * (vMacScreenBitWidth / uiblockbitsn),
-				(uibb *)screencomparebuff
-					+ NextDrawRow * (vMacScreenBitWidth / uiblockbitsn),
-				((uimr)(vMacScreenHeight - NextDrawRow)
-					* (uimr)vMacScreenBitWidth) / uiblockbitsn,
-				&j0))
-			{
-				NextDrawRow = 0;
-				return falseblnr;
-			}
-			j0v = j0 / (vMacScreenBitWidth / uiblockbitsn);
-			j0h = j0 - j0v * (vMacScreenBitWidth / uiblockbitsn);
-			j0v += NextDrawRow;
-			LimitDrawRow = j0v + MaxRowsDrawnPerTick;
-			if (LimitDrawRow >= vMacScreenHeight) {
-				LimitDrawRow = vMacScreenHeight;
-				NextDrawRow = 0;
-			} else {
-				NextDrawRow = LimitDrawRow;
-			}
-			FindLastChangeInLVecs((uibb *)screencurrentbuff,
-				(uibb *)screencomparebuff,
-				((uimr)LimitDrawRow
-					* (uimr)vMacScreenBitWidth) / uiblockbitsn,
-				&j1);
-			j1v = j1 / (vMacScreenBitWidth / uiblockbitsn);
-			j1h = j1 - j1v * (vMacScreenBitWidth / uiblockbitsn);
-			j1v++;
-
-			if (j0h < j1h) {
-				LeftMin = j0h;
-				RightMax = j1h;
-			} else {
-				LeftMin = j1h;
-				RightMax = j0h;
-			}
-
-			FindLeftRightChangeInLMat((uibb *)screencurrentbuff,
-				(uibb *)screencomparebuff,
-				(vMacScreenBitWidth / uiblockbitsn),
-				j0v, j1v, &LeftMin, &LeftMask, &RightMax, &RightMask);
-
-#if vMacScreenDepth > ln2uiblockbitsn
-			j0h =  (LeftMin >> (vMacScreenDepth - ln2uiblockbitsn));
-#elif ln2uiblockbitsn > vMacScreenDepth
-			for (j = 0; j < (1 << (ln2uiblockbitsn - vMacScreenDepth));
-				++j)
-			{
-				if (0 != (LeftMask
-					& (((((uibr)1) << (1 << vMacScreenDepth)) - 1)
-						<< ((j ^ FlipCheckBits) << vMacScreenDepth))))
-				{
-					goto Label_1c;
-				}
-			}
-Label_1c:
-			j0h =  (LeftMin << (ln2uiblockbitsn - vMacScreenDepth)) + j;
-#else
-			j0h =  LeftMin;
-#endif
-
-#if vMacScreenDepth > ln2uiblockbitsn
-			j1h = (RightMax >> (vMacScreenDepth - ln2uiblockbitsn)) + 1;
-#elif ln2uiblockbitsn > vMacScreenDepth
-			for (j = (uiblockbitsn >> vMacScreenDepth); --j >= 0; ) {
-				if (0 != (RightMask
-					& (((((uibr)1) << (1 << vMacScreenDepth)) - 1)
-						<< ((j ^ FlipCheckBits) << vMacScreenDepth))))
-				{
-					goto Label_2c;
-				}
-			}
-Label_2c:
-			j1h = (RightMax << (ln2uiblockbitsn - vMacScreenDepth))
-				+ j + 1;
-#else
-			j1h = RightMax + 1;
-#endif
-		}
-
-		copyrows = j1v - j0v;
-		copyoffset = j0v * vMacScreenByteWidth;
-		copysize = copyrows * vMacScreenByteWidth;
-	} else
-#endif
-	{
-#if 0 != vMacScreenDepth
-		if (ColorMappingChanged) {
-			ColorMappingChanged = falseblnr;
-			j0h = 0;
-			j1h = vMacScreenWidth;
-			j0v = 0;
-			j1v = vMacScreenHeight;
-#if WantColorTransValid
-			ColorTransValid = falseblnr;
-#endif
-		} else
-#endif
-		{
-			if (! FindFirstChangeInLVecs(
-				(uibb *)screencurrentbuff
-					+ NextDrawRow * (vMacScreenWidth / uiblockbitsn),
-				(uibb *)screencomparebuff
-					+ NextDrawRow * (vMacScreenWidth / uiblockbitsn),
-				((uimr)(vMacScreenHeight - NextDrawRow)
-					* (uimr)vMacScreenWidth) / uiblockbitsn,
-				&j0))
-			{
-				NextDrawRow = 0;
-				return falseblnr;
-			}
-			j0v = j0 / (vMacScreenWidth / uiblockbitsn);
-			j0h = j0 - j0v * (vMacScreenWidth / uiblockbitsn);
-			j0v += NextDrawRow;
-			LimitDrawRow = j0v + MaxRowsDrawnPerTick;
-			if (LimitDrawRow >= vMacScreenHeight) {
-				LimitDrawRow = vMacScreenHeight;
-				NextDrawRow = 0;
-			} else {
-				NextDrawRow = LimitDrawRow;
-			}
-			FindLastChangeInLVecs((uibb *)screencurrentbuff,
-				(uibb *)screencomparebuff,
-				((uimr)LimitDrawRow
-					* (uimr)vMacScreenWidth) / uiblockbitsn,
-				&j1);
-			j1v = j1 / (vMacScreenWidth / uiblockbitsn);
-			j1h = j1 - j1v * (vMacScreenWidth / uiblockbitsn);
-			j1v++;
-
-			if (j0h < j1h) {
-				LeftMin = j0h;
-				RightMax = j1h;
-			} else {
-				LeftMin = j1h;
-				RightMax = j0h;
-			}
-
-			FindLeftRightChangeInLMat((uibb *)screencurrentbuff,
-				(uibb *)screencomparebuff,
-				(vMacScreenWidth / uiblockbitsn),
-				j0v, j1v, &LeftMin, &LeftMask, &RightMax, &RightMask);
-
-			for (j = 0; j < uiblockbitsn; ++j) {
-				if (0 != (LeftMask
-					& (((uibr)1) << (j ^ FlipCheckMonoBits))))
-				{
-					goto Label_1;
-				}
-			}
-Label_1:
-			j0h = LeftMin * uiblockbitsn + j;
-
-			for (j = uiblockbitsn; --j >= 0; ) {
-				if (0 != (RightMask
-					& (((uibr)1) << (j ^ FlipCheckMonoBits))))
-				{
-					goto Label_2;
-				}
-			}
-Label_2:
-			j1h = RightMax * uiblockbitsn + j + 1;
-		}
-
-		copyrows = j1v - j0v;
-		copyoffset = j0v * vMacScreenMonoByteWidth;
-		copysize = copyrows * vMacScreenMonoByteWidth;
-	}
-
-	MyMoveBytes((anyp)screencurrentbuff + copyoffset,
-		(anyp)screencomparebuff + copyoffset,
-		copysize);
-
-	*top = j0v;
-	*left = j0h;
-	*bottom = j1v;
-	*right = j1h;
-
-	return trueblnr;
-}
+#include "SCRNFIND.h"
 
 GLOBALVAR blnr EmVideoDisable = falseblnr;
 GLOBALVAR si3b EmLagTime = 0;
@@ -631,6 +291,10 @@ GLOBALOSGLUPROC Screen_OutputFrame(ui3p screencurrentbuff)
 	si4b bottom;
 	si4b right;
 
+#if ScreenWriteTracked
+	screencomparebuff = screencurrentbuff;
+#endif
+
 	if (! EmVideoDisable) {
 		if (ScreenFindChanges(screencurrentbuff, EmLagTime,
 			&top, &left, &bottom, &right))
@@ -1042,6 +706,7 @@ LOCALPROC Keyboard_UpdateKeyMap(int key, blnr down)
 		}
 
 		QuietEnds();
+		AutoTurboInputNotify();
 	}
 }
 
@@ -1059,6 +724,7 @@ LOCALPROC MyMouseButtonSet(blnr down)
 		}
 
 		QuietEnds();
+		AutoTurboInputNotify();
 	}
 }
 
@@ -1080,6 +746,7 @@ LOCALPROC MyMousePositionSetDelta(ui4r dh, ui4r dv)
 		}
 
 		QuietEnds();
+		AutoTurboInputNotify();
 	}
 }
 #endif
@@ -1104,6 +771,7 @@ LOCALPROC MyMousePositionSet(ui4r h, ui4r v)
 		}
 
 		QuietEnds();
+		AutoTurboInputNotify();
 	}
 }
 
@@ -464,6 +464,7 @@ enum {
 #if EnableAutoSlow
 	kCntrlMsgNewAutoSlow,
 #endif
+	kCntrlMsgOvlDskEject,
 	kCntrlMsgAbout,
 	kCntrlMsgHelp,
 #if UseActvCode || EnableDemoMsg
@@ -511,6 +512,8 @@ LOCALPROC SetSpeedValue(ui3b i)
 #if VarFullScreen
 FORWARDPROC ToggleWantFullScreen(void);
 #endif
+FORWARDPROC OvlDskNextEjectAction(void);
+FORWARDFUNC char * OvlDskEjectActionStr(void);
 #if UseActvCode
 FORWARDPROC CopyRegistrationStr(void);
 #elif EnableDemoMsg
@@ -576,6 +579,22 @@ LOCALPROC DoControlModeKey(int key)
 				case MKC_H:
 					ControlMessage = kCntrlMsgHelp;
 					break;
+				case MKC_D:
+					OvlDskNextEjectAction();
+					ControlMessage = kCntrlMsgOvlDskEject;
+					break;
+#if WantTraceRing
+				case MKC_T:
+					WantTraceRingDump = trueblnr;
+					ControlMessage = kCntrlMsgBaseStart;
+					break;
+#endif
+#if WantTrapProfile
+				case MKC_L:
+					WantTrapProfToggle = trueblnr;
+					ControlMessage = kCntrlMsgBaseStart;
+					break;
+#endif
 #if NeedRequestInsertDisk
 				case MKC_O:
 					RequestInsertDisk = trueblnr;
@@ -779,6 +798,13 @@ LOCALPROC DrawCellsControlModeBody(void)
 			DrawCellsKeyCommand("K", kStrCmdCtrlKeyToggle);
 			DrawCellsKeyCommand("R", kStrCmdReset);
 			DrawCellsKeyCommand("I", kStrCmdInterrupt);
+			DrawCellsKeyCommand("D", kStrCmdOvlDskEject);
+#if WantTraceRing
+			DrawCellsKeyCommand("T", kStrCmdTraceDump);
+#endif
+#if WantTrapProfile
+			DrawCellsKeyCommand("L", kStrCmdTrapProfile);
+#endif
 			DrawCellsKeyCommand("H", kStrCmdHelp);
 			break;
 		case kCntrlMsgSpeedControlStart:
@@ -868,6 +894,9 @@ LOCALPROC DrawCellsControlModeBody(void)
 		case kCntrlMsgEmCntrl:
 			DrawCellsOneLineStr(kStrNewCntrlKey);
 			break;
+		case kCntrlMsgOvlDskEject:
+			DrawCellsOneLineStr(OvlDskEjectActionStr());
+			break;
 		case kCntrlMsgBaseStart:
 		default:
 			DrawCellsOneLineStr(kStrHowToLeaveControl);
@@ -0,0 +1,478 @@
+/*
+	DGLUCMPR.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	Disk GLUe for CoMPRessed disk images
+
+	A compressed image is the raw image (which may itself
+	be a Disk Copy 4.2 image) split into fixed size chunks,
+	each deflated on its own with zlib, so any part of the
+	image can be read without decompressing what comes
+	before it. Layout, all values big endian:
+
+	header (kCmpDskHeaderSize bytes)
+		 0 magic, 'MVZ1'
+		 4 log2 of the chunk size
+		 8 size of the uncompressed image
+		12 number of chunks
+		16 offset of the index
+	index (8 bytes per chunk)
+		 0 offset of the chunk data in the file
+		 4 length of the chunk data. 0 means the chunk
+			is all zeroes, the chunk size means it is
+			stored uncompressed.
+
+	Chunks written by the emulated machine are never
+	rewritten in place. They are deflated again and
+	appended to the end of the file, and on eject a new
+	index is appended and the header updated to point
+	at it. The space taken by the old copies is given back
+	by converting the image again on the host (see
+	tools/MVZIMAGE.c).
+
+	Recently used chunks are kept decompressed in a small
+	cache shared by all drives.
+*/
+
+#define kCmpDskMagic 0x4D565A31
+#define kCmpDskHeaderSize 32
+
+#define kCmpDskoffset_magic 0
+#define kCmpDskoffset_chunkShift 4
+#define kCmpDskoffset_imageSize 8
+#define kCmpDskoffset_numChunks 12
+#define kCmpDskoffset_indexOffset 16
+
+#define kCmpDskMinChunkShift 9
+#define kCmpDskMaxChunkShift 16
+#define kCmpDskMaxChunkSize (1UL << kCmpDskMaxChunkShift)
+
+#ifndef CmpDskCacheN
+#define CmpDskCacheN 8
+#endif
+
+struct CmpDskR {
+	ui5r ImageSize;
+	ui5r ChunkShift;
+	ui5r NumChunks;
+	ui5r FileEnd; /* where the next rewritten chunk goes */
+	ui5b *Index; /* offset and length for each chunk */
+	blnr IndexChanged;
+};
+typedef struct CmpDskR CmpDskR;
+
+LOCALVAR CmpDskR *CmpDsks[NumDrives]; /* null if not compressed */
+
+struct CmpDskCacheEl {
+	ui3p Dat;
+	ui5r Chunk;
+	ui5r LastUse;
+	tDrive Drive_No;
+	blnr InUse;
+	blnr Dirty;
+};
+typedef struct CmpDskCacheEl CmpDskCacheEl;
+
+LOCALVAR CmpDskCacheEl CmpDskCache[CmpDskCacheN];
+LOCALVAR ui5r CmpDskUseCounter = 0;
+LOCALVAR ui3p CmpDskScratch = nullpr;
+	/* holds compressed data going to or from the file */
+LOCALVAR uLong CmpDskScratchSz = 0;
+
+#define CmpDskIsCompressed(Drive_No) (nullpr != CmpDsks[Drive_No])
+
+LOCALFUNC ui5r CmpDskChunkLen(CmpDskR *d, ui5r Chunk)
+{
+	ui5r Start = Chunk << d->ChunkShift;
+	ui5r L = d->ImageSize - Start;
+	ui5r ChunkSize = (ui5r)1 << d->ChunkShift;
+
+	return (L > ChunkSize) ? ChunkSize : L;
+}
+
+LOCALFUNC blnr CmpDskChunkIsZero(ui3p p, ui5r L)
+{
+	while (0 != L) {
+		--L;
+		if (0 != *p++) {
+			return falseblnr;
+		}
+	}
+	return trueblnr;
+}
+
+LOCALFUNC blnr CmpDskReadChunk(tDrive Drive_No, ui5r Chunk, ui3p Dat)
+{
+	CmpDskR *d = CmpDsks[Drive_No];
+	FILE *refnum = Drives[Drive_No];
+	ui5r ChunkLen = CmpDskChunkLen(d, Chunk);
+	ui5r Offset = d->Index[2 * Chunk];
+	ui5r L = d->Index[2 * Chunk + 1];
+	uLongf DestLen = ChunkLen;
+
+	if (0 == L) {
+		memset(Dat, 0, ChunkLen);
+		return trueblnr;
+	}
+
+	if (0 != fseek(refnum, Offset, SEEK_SET)) {
+		return falseblnr;
+	}
+
+	if (L == ChunkLen) {
+		return L == fread(Dat, 1, L, refnum);
+	}
+
+	if ((L > CmpDskScratchSz) || (L != fread(CmpDskScratch, 1, L, refnum)))
+	{
+		return falseblnr;
+	}
+
+	return (Z_OK == uncompress(Dat, &DestLen, CmpDskScratch, L))
+		&& (DestLen == ChunkLen);
+}
+
+LOCALFUNC blnr CmpDskWriteChunk(tDrive Drive_No, ui5r Chunk, ui3p Dat)
+{
+	CmpDskR *d = CmpDsks[Drive_No];
+	FILE *refnum = Drives[Drive_No];
+	ui5r ChunkLen = CmpDskChunkLen(d, Chunk);
+	uLongf L = CmpDskScratchSz;
+	ui3p p = CmpDskScratch;
+
+	if (CmpDskChunkIsZero(Dat, ChunkLen)) {
+		L = 0;
+	} else if ((Z_OK != compress2(CmpDskScratch, &L, Dat, ChunkLen,
+		Z_BEST_SPEED)) || (L >= ChunkLen))
+	{
+		L = ChunkLen;
+		p = Dat;
+	}
+
+	if (0 != L) {
+		if ((0 != fseek(refnum, d->FileEnd, SEEK_SET))
+			|| (L != fwrite(p, 1, L, refnum)))
+		{
+			return falseblnr;
+		}
+	}
+
+	d->Index[2 * Chunk] = d->FileEnd;
+	d->Index[2 * Chunk + 1] = L;
+	d->FileEnd += L;
+	d->IndexChanged = trueblnr;
+
+	return trueblnr;
+}
+
+/*
+	A chunk stays dirty if it could not be written, so a
+	later flush can try again, and it is never dropped from
+	the cache while it still holds data not in the file.
+*/
+LOCALFUNC blnr CmpDskCacheFlushEl(CmpDskCacheEl *e)
+{
+	if (e->InUse && e->Dirty) {
+		if (! CmpDskWriteChunk(e->Drive_No, e->Chunk, e->Dat)) {
+			return falseblnr;
+		}
+		e->Dirty = falseblnr;
+	}
+
+	return trueblnr;
+}
+
+LOCALFUNC CmpDskCacheEl * CmpDskGetChunk(tDrive Drive_No, ui5r Chunk)
+{
+	int i;
+	CmpDskCacheEl *e;
+	CmpDskCacheEl *victim = &CmpDskCache[0];
+
+	for (i = 0; i < CmpDskCacheN; ++i) {
+		e = &CmpDskCache[i];
+		if (e->InUse && (e->Drive_No == Drive_No) && (e->Chunk == Chunk))
+		{
+			e->LastUse = ++CmpDskUseCounter;
+			return e;
+		}
+		if ((! e->InUse)
+			|| (victim->InUse && (e->LastUse < victim->LastUse)))
+		{
+			victim = e;
+		}
+	}
+
+	if (! CmpDskCacheFlushEl(victim)) {
+		return nullpr;
+	}
+
+	victim->InUse = falseblnr;
+	if (! CmpDskReadChunk(Drive_No, Chunk, victim->Dat)) {
+		return nullpr;
+	}
+
+	victim->InUse = trueblnr;
+	victim->Dirty = falseblnr;
+	victim->Drive_No = Drive_No;
+	victim->Chunk = Chunk;
+	victim->LastUse = ++CmpDskUseCounter;
+
+	return victim;
+}
+
+LOCALFUNC tMacErr CmpDskTransfer(blnr IsWrite, ui3p Buffer,
+	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
+	ui5r *Sony_ActCount)
+{
+	tMacErr err = mnvm_noErr;
+	CmpDskR *d = CmpDsks[Drive_No];
+	ui5r ChunkMask = ((ui5r)1 << d->ChunkShift) - 1;
+	ui5r n = 0;
+	ui5r Offset;
+	ui5r L;
+	CmpDskCacheEl *e;
+
+	if ((Sony_Start > d->ImageSize)
+		|| (Sony_Count > d->ImageSize - Sony_Start))
+	{
+		err = mnvm_eofErr;
+		Sony_Count = (Sony_Start > d->ImageSize)
+			? 0 : d->ImageSize - Sony_Start;
+	}
+
+	while (n < Sony_Count) {
+		e = CmpDskGetChunk(Drive_No, Sony_Start >> d->ChunkShift);
+		if (nullpr == e) {
+			err = mnvm_miscErr;
+			break;
+		}
+
+		Offset = Sony_Start & ChunkMask;
+		L = ChunkMask + 1 - Offset;
+		if (L > Sony_Count - n) {
+			L = Sony_Count - n;
+		}
+
+		if (IsWrite) {
+			MyMoveBytes((anyp)Buffer, (anyp)(e->Dat + Offset), L);
+			e->Dirty = trueblnr;
+		} else {
+			MyMoveBytes((anyp)(e->Dat + Offset), (anyp)Buffer, L);
+		}
+
+		Buffer += L;
+		Sony_Start += L;
+		n += L;
+	}
+
+	if (nullpr != Sony_ActCount) {
+		*Sony_ActCount = n;
+	}
+
+	return err;
+}
+
+LOCALPROC CmpDskDispose(tDrive Drive_No)
+{
+	CmpDskR *d = CmpDsks[Drive_No];
+
+	if (nullpr != d) {
+		if (nullpr != d->Index) {
+			free(d->Index);
+		}
+		free(d);
+		CmpDsks[Drive_No] = nullpr;
+	}
+}
+
+/*
+	Returns an error if any written data, or the new index,
+	could not be saved. The drive is closed either way.
+*/
+LOCALFUNC tMacErr CmpDskClose(tDrive Drive_No)
+{
+	int i;
+	ui5r j;
+	ui3b Buffer[8];
+	CmpDskR *d = CmpDsks[Drive_No];
+	FILE *refnum = Drives[Drive_No];
+	blnr IsOk = trueblnr;
+
+	for (i = 0; i < CmpDskCacheN; ++i) {
+		CmpDskCacheEl *e = &CmpDskCache[i];
+
+		if (e->InUse && (e->Drive_No == Drive_No)) {
+			if (! CmpDskCacheFlushEl(e)) {
+				IsOk = falseblnr;
+			}
+			e->InUse = falseblnr;
+		}
+	}
+
+	if (IsOk && d->IndexChanged) {
+		/*
+			Append the new index, and only then point the
+			header at it, so that an interrupted write
+			leaves the old index in effect.
+		*/
+		if (0 != fseek(refnum, d->FileEnd, SEEK_SET)) {
+			IsOk = falseblnr;
+		}
+		for (j = 0; IsOk && (j < 2 * d->NumChunks); j += 2) {
+			do_put_mem_long(Buffer, d->Index[j]);
+			do_put_mem_long(Buffer + 4, d->Index[j + 1]);
+			if (8 != fwrite(Buffer, 1, 8, refnum)) {
+				IsOk = falseblnr;
+			}
+		}
+		if (IsOk) {
+			do_put_mem_long(Buffer, d->FileEnd);
+			IsOk = (0 == fseek(refnum, kCmpDskoffset_indexOffset,
+					SEEK_SET))
+				&& (4 == fwrite(Buffer, 1, 4, refnum));
+		}
+	}
+
+	if (! IsOk) {
+		WriteExtraErr("failed to update compressed disk image");
+	}
+
+	CmpDskDispose(Drive_No);
+
+	return IsOk ? mnvm_noErr : mnvm_miscErr;
+}
+
+LOCALPROC CmpDskUnInit(void)
+{
+	int i;
+
+	for (i = 0; i < CmpDskCacheN; ++i) {
+		if (nullpr != CmpDskCache[i].Dat) {
+			free(CmpDskCache[i].Dat);
+			CmpDskCache[i].Dat = nullpr;
+		}
+	}
+	if (nullpr != CmpDskScratch) {
+		free(CmpDskScratch);
+		CmpDskScratch = nullpr;
+	}
+}
+
+LOCALFUNC blnr CmpDskAllocCache(void)
+{
+	int i;
+
+	if (nullpr == CmpDskScratch) {
+		CmpDskScratchSz = compressBound(kCmpDskMaxChunkSize);
+		CmpDskScratch = (ui3p)malloc(CmpDskScratchSz);
+		if (nullpr == CmpDskScratch) {
+			return falseblnr;
+		}
+		for (i = 0; i < CmpDskCacheN; ++i) {
+			CmpDskCache[i].InUse = falseblnr;
+			CmpDskCache[i].Dat = (ui3p)malloc(kCmpDskMaxChunkSize);
+			if (nullpr == CmpDskCache[i].Dat) {
+				/* so the next try starts over */
+				CmpDskUnInit();
+				return falseblnr;
+			}
+		}
+	}
+
+	return trueblnr;
+}
+
+/*
+	Sets up CmpDsks[Drive_No] if the file in Drives[Drive_No]
+	is a compressed image. Returns false if it looks like one
+	but can't be used.
+*/
+LOCALFUNC blnr CmpDskOpen(tDrive Drive_No)
+{
+	ui3b Header[kCmpDskHeaderSize];
+	ui3b Buffer[8];
+	ui5r IndexOffset;
+	ui5r j;
+	long v;
+	CmpDskR *d;
+	FILE *refnum = Drives[Drive_No];
+
+	CmpDsks[Drive_No] = nullpr;
+
+	if ((0 != fseek(refnum, 0, SEEK_SET))
+		|| (kCmpDskHeaderSize != fread(Header, 1, kCmpDskHeaderSize,
+			refnum))
+		|| (kCmpDskMagic != do_get_mem_long(Header + kCmpDskoffset_magic)))
+	{
+		return trueblnr; /* not compressed, use as is */
+	}
+
+	if ((0 != fseek(refnum, 0, SEEK_END)) || ((v = ftell(refnum)) < 0)) {
+		return falseblnr;
+	}
+
+	if (! CmpDskAllocCache()) {
+		return falseblnr;
+	}
+
+	d = (CmpDskR *)calloc(1, sizeof(CmpDskR));
+	if (nullpr == d) {
+		return falseblnr;
+	}
+	CmpDsks[Drive_No] = d;
+
+	d->ChunkShift = do_get_mem_long(Header + kCmpDskoffset_chunkShift);
+	d->ImageSize = do_get_mem_long(Header + kCmpDskoffset_imageSize);
+	d->NumChunks = do_get_mem_long(Header + kCmpDskoffset_numChunks);
+	IndexOffset = do_get_mem_long(Header + kCmpDskoffset_indexOffset);
+	d->FileEnd = v;
+
+	if ((d->ChunkShift < kCmpDskMinChunkShift)
+		|| (d->ChunkShift > kCmpDskMaxChunkShift)
+		|| (d->NumChunks != ((d->ImageSize
+			+ ((ui5r)1 << d->ChunkShift) - 1) >> d->ChunkShift))
+		|| (IndexOffset > d->FileEnd)
+		|| (d->NumChunks > (d->FileEnd - IndexOffset) / 8))
+	{
+		goto label_fail;
+	}
+
+	d->Index = (ui5b *)malloc(d->NumChunks * 2 * sizeof(ui5b) + 1);
+	if ((nullpr == d->Index)
+		|| (0 != fseek(refnum, IndexOffset, SEEK_SET)))
+	{
+		goto label_fail;
+	}
+
+	for (j = 0; j < d->NumChunks; ++j) {
+		if (8 != fread(Buffer, 1, 8, refnum)) {
+			goto label_fail;
+		}
+		d->Index[2 * j] = do_get_mem_long(Buffer);
+		d->Index[2 * j + 1] = do_get_mem_long(Buffer + 4);
+		if ((d->Index[2 * j + 1] > CmpDskChunkLen(d, j))
+			|| (d->Index[2 * j] > d->FileEnd)
+			|| (d->Index[2 * j + 1] > d->FileEnd - d->Index[2 * j]))
+		{
+			goto label_fail;
+		}
+	}
+
+	return trueblnr;
+
+label_fail:
+	WriteExtraErr("bad compressed disk image");
+	CmpDskDispose(Drive_No);
+	return falseblnr;
+}
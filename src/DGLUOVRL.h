@@ -0,0 +1,424 @@
+/*
+	DGLUOVRL.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	Disk GLUe for OVeRLay files
+
+	If there is a file named like the disk image with
+	".ovl" added when the image is inserted, writes go to
+	that file instead of the image, a block at a time, and
+	the image is never written to. So one base image, such
+	as a System disk, can be shared by several setups that
+	each have their own overlay. An empty file is fine, it
+	is set up when the image is inserted.
+
+	Layout, all values big endian:
+
+	header (kOvlDskHeaderSize bytes)
+		 0 magic, 'MVO1'
+		 4 size of the base image
+		 8 block size
+		12 reserved, 0
+	map (4 bytes per block of the base image)
+		slot number of the block plus one, or 0 if the
+		block is only in the base image
+	slots (kOvlDskBlockSize bytes each)
+
+	The whole map is kept in memory, so finding where a block
+	is never involves a search. A slot is always written
+	before the map entry that points at it.
+
+	OvlDskEjectAction picks what is done with the overlay
+	on eject, or on quit: keep it for next time, commit it
+	(copy the blocks into the base image and empty the
+	overlay), or discard it (just empty the overlay). It
+	starts out as DiskOverlayEjectAction, and the D command
+	of control mode steps through the three.
+*/
+
+#define kOvlDskMagic 0x4D564F31
+#define kOvlDskHeaderSize 16
+#define kOvlDskBlockSize 512
+
+#define kOvlDskoffset_magic 0
+#define kOvlDskoffset_baseSize 4
+#define kOvlDskoffset_blockSize 8
+
+#define kOvlDskKeep 0
+#define kOvlDskCommit 1
+#define kOvlDskDiscard 2
+
+#ifndef DiskOverlayEjectAction
+#define DiskOverlayEjectAction kOvlDskKeep
+#endif
+
+LOCALVAR int OvlDskEjectAction = DiskOverlayEjectAction;
+
+struct OvlDskR {
+	FILE *File;
+	ui5r BaseSize;
+	ui5r NumBlocks;
+	ui5r NumSlots;
+	ui5b *Map;
+	blnr BaseLocked;
+};
+typedef struct OvlDskR OvlDskR;
+
+LOCALVAR OvlDskR *OvlDsks[NumDrives]; /* null if no overlay */
+
+#define OvlDskIsOverlaid(Drive_No) (nullpr != OvlDsks[Drive_No])
+
+#define OvlDskSlotOffset(d, Slot) (kOvlDskHeaderSize \
+	+ 4 * (d)->NumBlocks + (Slot) * kOvlDskBlockSize)
+
+LOCALFUNC ui5r OvlDskBlockLen(OvlDskR *d, ui5r i)
+{
+	ui5r L = d->BaseSize - i * kOvlDskBlockSize;
+
+	return (L > kOvlDskBlockSize) ? kOvlDskBlockSize : L;
+}
+
+LOCALFUNC tMacErr OvlDskNewSlot(tDrive Drive_No, ui5r i,
+	ui3p Buffer, ui5r Offset, ui5r L)
+{
+	tMacErr err;
+	ui3b Block[kOvlDskBlockSize];
+	ui3b MapEntry[4];
+	OvlDskR *d = OvlDsks[Drive_No];
+	ui5r BlockLen = OvlDskBlockLen(d, i);
+
+	if ((0 != Offset) || (L != BlockLen)) {
+		err = vSonyTransfer0(falseblnr, Block, Drive_No,
+			i * kOvlDskBlockSize, BlockLen, nullpr);
+		if (mnvm_noErr != err) {
+			return err;
+		}
+	}
+	memset(Block + BlockLen, 0, kOvlDskBlockSize - BlockLen);
+	MyMoveBytes((anyp)Buffer, (anyp)(Block + Offset), L);
+
+	do_put_mem_long(MapEntry, d->NumSlots + 1);
+	if ((0 != fseek(d->File, OvlDskSlotOffset(d, d->NumSlots), SEEK_SET))
+		|| (kOvlDskBlockSize != fwrite(Block, 1, kOvlDskBlockSize,
+			d->File))
+		|| (0 != fseek(d->File, kOvlDskHeaderSize + 4 * i, SEEK_SET))
+		|| (4 != fwrite(MapEntry, 1, 4, d->File)))
+	{
+		return mnvm_miscErr;
+	}
+
+	d->Map[i] = ++d->NumSlots;
+
+	return mnvm_noErr;
+}
+
+LOCALFUNC tMacErr OvlDskTransfer(blnr IsWrite, ui3p Buffer,
+	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
+	ui5r *Sony_ActCount)
+{
+	tMacErr err = mnvm_noErr;
+	tMacErr err2;
+	OvlDskR *d = OvlDsks[Drive_No];
+	ui5r n = 0;
+	ui5r i;
+	ui5r Slot;
+	ui5r Offset;
+	ui5r L;
+
+	if ((Sony_Start > d->BaseSize)
+		|| (Sony_Count > d->BaseSize - Sony_Start))
+	{
+		err = mnvm_eofErr;
+		Sony_Count = (Sony_Start > d->BaseSize)
+			? 0 : d->BaseSize - Sony_Start;
+	}
+
+	while (n < Sony_Count) {
+		i = Sony_Start / kOvlDskBlockSize;
+		Offset = Sony_Start % kOvlDskBlockSize;
+		Slot = d->Map[i];
+		L = kOvlDskBlockSize - Offset;
+
+		if ((0 == Slot) && ! IsWrite) {
+			/* read a run of blocks from the base in one go */
+			while ((L < Sony_Count - n) && (0 == d->Map[++i])) {
+				L += kOvlDskBlockSize;
+			}
+		}
+		if (L > Sony_Count - n) {
+			L = Sony_Count - n;
+		}
+
+		if (0 == Slot) {
+			if (IsWrite) {
+				err2 = OvlDskNewSlot(Drive_No, i, Buffer, Offset, L);
+			} else {
+				err2 = vSonyTransfer0(falseblnr, Buffer, Drive_No,
+					Sony_Start, L, nullpr);
+			}
+		} else if (0 != fseek(d->File,
+			OvlDskSlotOffset(d, Slot - 1) + Offset, SEEK_SET))
+		{
+			err2 = mnvm_miscErr;
+		} else if (L != (IsWrite
+			? fwrite(Buffer, 1, L, d->File)
+			: fread(Buffer, 1, L, d->File)))
+		{
+			err2 = mnvm_miscErr;
+		} else {
+			err2 = mnvm_noErr;
+		}
+
+		if (mnvm_noErr != err2) {
+			err = err2;
+			break;
+		}
+
+		Buffer += L;
+		Sony_Start += L;
+		n += L;
+	}
+
+	if (nullpr != Sony_ActCount) {
+		*Sony_ActCount = n;
+	}
+
+	return err;
+}
+
+/*
+	Write out a header and an empty map, forgetting
+	any blocks already in the file. The space they
+	take is reused by later writes.
+*/
+LOCALFUNC blnr OvlDskReset(OvlDskR *d)
+{
+	ui3b Buffer[kOvlDskBlockSize];
+	ui5r i;
+	ui5r L;
+
+	memset(Buffer, 0, kOvlDskBlockSize);
+	do_put_mem_long(Buffer + kOvlDskoffset_magic, kOvlDskMagic);
+	do_put_mem_long(Buffer + kOvlDskoffset_baseSize, d->BaseSize);
+	do_put_mem_long(Buffer + kOvlDskoffset_blockSize, kOvlDskBlockSize);
+
+	if ((0 != fseek(d->File, 0, SEEK_SET))
+		|| (kOvlDskHeaderSize != fwrite(Buffer, 1, kOvlDskHeaderSize,
+			d->File)))
+	{
+		return falseblnr;
+	}
+
+	memset(Buffer, 0, kOvlDskHeaderSize);
+	for (i = 4 * d->NumBlocks; 0 != i; i -= L) {
+		L = (i > kOvlDskBlockSize) ? kOvlDskBlockSize : i;
+		if (L != fwrite(Buffer, 1, L, d->File)) {
+			return falseblnr;
+		}
+	}
+
+	for (i = 0; i < d->NumBlocks; ++i) {
+		d->Map[i] = 0;
+	}
+	d->NumSlots = 0;
+
+	return 0 == fflush(d->File);
+}
+
+LOCALFUNC blnr OvlDskCommit(tDrive Drive_No)
+{
+	ui3b Block[kOvlDskBlockSize];
+	OvlDskR *d = OvlDsks[Drive_No];
+	ui5r i;
+	ui5r L;
+
+	if (d->BaseLocked) {
+		WriteExtraErr("disk image is locked, overlay not committed");
+		return falseblnr;
+	}
+
+	for (i = 0; i < d->NumBlocks; ++i) {
+		if (0 != d->Map[i]) {
+			L = OvlDskBlockLen(d, i);
+			if ((0 != fseek(d->File,
+					OvlDskSlotOffset(d, d->Map[i] - 1), SEEK_SET))
+				|| (L != fread(Block, 1, L, d->File))
+				|| (mnvm_noErr != vSonyTransfer0(trueblnr, Block,
+					Drive_No, i * kOvlDskBlockSize, L, nullpr)))
+			{
+				WriteExtraErr("failed to commit disk overlay");
+				return falseblnr;
+			}
+		}
+	}
+
+	return trueblnr;
+}
+
+LOCALPROC OvlDskDispose(tDrive Drive_No)
+{
+	OvlDskR *d = OvlDsks[Drive_No];
+
+	if (nullpr != d) {
+		if (nullpr != d->Map) {
+			free(d->Map);
+		}
+		if (NULL != d->File) {
+			fclose(d->File);
+		}
+		free(d);
+		OvlDsks[Drive_No] = nullpr;
+	}
+}
+
+/*
+	Has to be called while the base image is still
+	open, so the blocks can be committed to it.
+*/
+LOCALPROC OvlDskClose(tDrive Drive_No)
+{
+	OvlDskR *d = OvlDsks[Drive_No];
+
+	if ((kOvlDskKeep != OvlDskEjectAction) && (0 != d->NumSlots)) {
+		if ((kOvlDskDiscard == OvlDskEjectAction)
+			|| OvlDskCommit(Drive_No))
+		{
+			if (! OvlDskReset(d)) {
+				WriteExtraErr("failed to empty disk overlay");
+			}
+		}
+	}
+
+	OvlDskDispose(Drive_No);
+}
+
+/* for control mode, keep then commit then discard */
+LOCALPROC OvlDskNextEjectAction(void)
+{
+	if (kOvlDskDiscard == OvlDskEjectAction) {
+		OvlDskEjectAction = kOvlDskKeep;
+	} else {
+		++OvlDskEjectAction;
+	}
+}
+
+LOCALFUNC char * OvlDskEjectActionStr(void)
+{
+	char *s;
+
+	switch (OvlDskEjectAction) {
+		case kOvlDskCommit:
+			s = kStrNewOvlDskCommit;
+			break;
+		case kOvlDskDiscard:
+			s = kStrNewOvlDskDiscard;
+			break;
+		case kOvlDskKeep:
+		default:
+			s = kStrNewOvlDskKeep;
+			break;
+	}
+
+	return s;
+}
+
+/*
+	Sets up OvlDsks[Drive_No] if the image inserted from
+	drivepath has an overlay file. Returns false if there
+	is one but it can't be used.
+*/
+LOCALFUNC blnr OvlDskOpen(tDrive Drive_No, char *drivepath,
+	blnr locked)
+{
+	ui3b Header[kOvlDskHeaderSize];
+	char *OvlPath;
+	ui5r BaseSize;
+	ui5r i;
+	long v;
+	OvlDskR *d;
+	FILE *refnum;
+
+	OvlDsks[Drive_No] = nullpr;
+
+	OvlPath = (char *)malloc(strlen(drivepath) + 5);
+	if (nullpr == OvlPath) {
+		return falseblnr;
+	}
+	strcpy(OvlPath, drivepath);
+	strcat(OvlPath, ".ovl");
+	refnum = fopen(OvlPath, "rb+");
+	free(OvlPath);
+	if (NULL == refnum) {
+		return trueblnr; /* no overlay, use image as is */
+	}
+
+	d = (OvlDskR *)calloc(1, sizeof(OvlDskR));
+	if (nullpr == d) {
+		fclose(refnum);
+		return falseblnr;
+	}
+	OvlDsks[Drive_No] = d;
+	d->File = refnum;
+	d->BaseLocked = locked;
+
+	if ((mnvm_noErr != vSonyGetSize(Drive_No, &BaseSize))
+		|| (0 != fseek(refnum, 0, SEEK_END))
+		|| ((v = ftell(refnum)) < 0))
+	{
+		goto label_fail;
+	}
+	d->BaseSize = BaseSize;
+	d->NumBlocks = (BaseSize + kOvlDskBlockSize - 1) / kOvlDskBlockSize;
+
+	d->Map = (ui5b *)malloc(d->NumBlocks * sizeof(ui5b) + 1);
+	if (nullpr == d->Map) {
+		goto label_fail;
+	}
+
+	if (0 == v) {
+		if (! OvlDskReset(d)) {
+			goto label_fail;
+		}
+		return trueblnr;
+	}
+
+	if ((0 != fseek(refnum, 0, SEEK_SET))
+		|| (kOvlDskHeaderSize != fread(Header, 1, kOvlDskHeaderSize,
+			refnum))
+		|| (kOvlDskMagic != do_get_mem_long(Header + kOvlDskoffset_magic))
+		|| (BaseSize != do_get_mem_long(Header + kOvlDskoffset_baseSize))
+		|| (kOvlDskBlockSize
+			!= do_get_mem_long(Header + kOvlDskoffset_blockSize))
+		|| (d->NumBlocks != fread(d->Map, 4, d->NumBlocks, refnum)))
+	{
+		goto label_fail;
+	}
+
+	for (i = 0; i < d->NumBlocks; ++i) {
+		d->Map[i] = do_get_mem_long((ui3p)&d->Map[i]);
+		if (d->Map[i] > d->NumSlots) {
+			d->NumSlots = d->Map[i];
+		}
+	}
+	if ((ui5r)v < OvlDskSlotOffset(d, d->NumSlots)) {
+		goto label_fail;
+	}
+
+	return trueblnr;
+
+label_fail:
+	WriteExtraErr("bad disk overlay file");
+	OvlDskDispose(Drive_No);
+	return falseblnr;
+}
@@ -0,0 +1,149 @@
+/*
+	FRMPACER.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	FRaMe PACER
+
+	Decides, once per emulated tick, whether the glue should
+	draw all of the changed part of the screen, only as many
+	rows as still fit in the tick, or nothing at all, so that
+	the emulation keeps up with real time and it is the video
+	that suffers when the host is too slow.
+
+	The glue reports how long emulating a tick, converting the
+	screen, and presenting it took, in microseconds, and running
+	averages of those make up the prediction. Nothing here calls
+	the host, so the glue supplies all the times.
+*/
+
+#ifndef kFramePacerTickUs /* length of an emulated tick */
+#define kFramePacerTickUs 16626
+#endif
+
+#ifndef kFramePacerMaxSkip
+	/* ticks in a row that may go undrawn before drawing anyway */
+#define kFramePacerMaxSkip 4
+#endif
+
+#ifndef kFramePacerMinRows
+	/* partial draws smaller than this are not worth doing */
+#define kFramePacerMinRows 16
+#endif
+
+#define kFramePacerAvgShift 3 /* averages weigh a new sample 1/8 */
+
+#define kFramePacerHistShift 11 /* about 2 milliseconds per bucket */
+#define kFramePacerHistN 16
+
+enum {
+	kFramePacerFull,
+	kFramePacerPartial,
+	kFramePacerSkip,
+
+	kNumFramePacerDecisions
+};
+
+typedef struct {
+	/* running averages, scaled by (1 << kFramePacerAvgShift) */
+	ui5r EmuCost8;
+	ui5r RowCost8; /* in sixteenths of a microsecond per row */
+	ui5r PresentCost8;
+
+	ui5r SkipsInARow;
+
+	/* for tuning, never cleared */
+	ui5r Decisions[kNumFramePacerDecisions];
+	ui5r Hist[kFramePacerHistN]; /* time between tick starts */
+} FramePacerR;
+
+LOCALVAR FramePacerR FramePacer;
+
+#define FramePacer_Avg(a8) ((a8) >> kFramePacerAvgShift)
+
+LOCALPROC FramePacer_AvgIn(ui5r *a8, ui5r v)
+{
+	if (0 == *a8) {
+		*a8 = v << kFramePacerAvgShift;
+	} else {
+		*a8 = *a8 - FramePacer_Avg(*a8) + v;
+	}
+}
+
+LOCALPROC FramePacer_NoteEmu(ui5r us)
+{
+	FramePacer_AvgIn(&FramePacer.EmuCost8, us);
+}
+
+LOCALPROC FramePacer_NoteDraw(ui5r us, ui5r Rows)
+{
+	if (Rows > 0) {
+		FramePacer_AvgIn(&FramePacer.RowCost8, (us << 4) / Rows);
+	}
+}
+
+LOCALPROC FramePacer_NotePresent(ui5r us)
+{
+	FramePacer_AvgIn(&FramePacer.PresentCost8, us);
+}
+
+LOCALPROC FramePacer_NoteTickTime(ui5r us)
+{
+	ui5r i = us >> kFramePacerHistShift;
+
+	if (i >= kFramePacerHistN) {
+		i = kFramePacerHistN - 1;
+	}
+	++FramePacer.Hist[i];
+}
+
+/*
+	Elapsed is how much of the current tick has gone by, Rows
+	how many rows are waiting to be drawn. Returns one of the
+	kFramePacer decisions, and for kFramePacerPartial sets
+	*RowsToDraw.
+*/
+LOCALFUNC int FramePacer_Decide(ui5r Elapsed, ui5r Rows,
+	ui5r *RowsToDraw)
+{
+	int v;
+	ui5r RowCost = FramePacer_Avg(FramePacer.RowCost8);
+	ui5r Spend = Elapsed + FramePacer_Avg(FramePacer.PresentCost8);
+	ui5r Left = (Spend < kFramePacerTickUs)
+		? (kFramePacerTickUs - Spend) : 0;
+	ui5r n;
+
+	if ((0 == RowCost)
+		|| (((Rows * RowCost) >> 4) <= Left)
+		|| (FramePacer.SkipsInARow >= kFramePacerMaxSkip))
+	{
+		v = kFramePacerFull;
+	} else {
+		n = (Left << 4) / RowCost;
+		if (n >= kFramePacerMinRows) {
+			*RowsToDraw = n;
+			v = kFramePacerPartial;
+		} else {
+			v = kFramePacerSkip;
+		}
+	}
+
+	if (kFramePacerSkip == v) {
+		++FramePacer.SkipsInARow;
+	} else {
+		FramePacer.SkipsInARow = 0;
+	}
+	++FramePacer.Decisions[v];
+
+	return v;
+}
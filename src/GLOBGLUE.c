@@ -35,7 +35,7 @@
 #include "GLOBGLUE.h"
 
 /*
-	ReportAbnormalID unused 0x111D - 0x11FF
+	ReportAbnormalID unused 0x111F - 0x11FF
 */
 
 /*
@@ -69,6 +69,7 @@ IMPORTPROC SetCyclesRemaining(ui5b n);
 
 IMPORTPROC SetHeadATTel(ATTep p);
 IMPORTFUNC ATTep FindATTel(CPTR addr);
+IMPORTPROC m68k_ATTAccessChngNtfy(void);
 
 IMPORTFUNC ui5b SCSI_Access(ui5b Data, blnr WriteMem, CPTR addr);
 IMPORTFUNC ui5b SCC_Access(ui5b Data, blnr WriteMem, CPTR addr);
@@ -116,6 +117,59 @@ GLOBALPROC customreset(void)
 }
 
 GLOBALVAR ui3p RAM = nullpr;
+GLOBALVAR ui5r RAMa_Size = kRAMa_Size;
+GLOBALVAR ui5r RAMb_Size = kRAMb_Size;
+
+/*
+	ways the two banks of RAM could be filled on the real
+	machine, largest first. kRAMa_Size and kRAMb_Size are the
+	most this build allows.
+*/
+
+LOCALVAR const ui5b RAMBankSizes[][2] = {
+#if (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
+	{ 0x00400000, 0x00400000 },
+	{ 0x00400000, 0x00100000 },
+	{ 0x00400000, 0x00000000 },
+	{ 0x00100000, 0x00100000 },
+	{ 0x00100000, 0x00000000 },
+#elif (CurEmMd >= kEmMd_Plus) && (CurEmMd <= kEmMd_Classic)
+	{ 0x00200000, 0x00200000 },
+	{ 0x00200000, 0x00080000 },
+	{ 0x00200000, 0x00000000 },
+	{ 0x00080000, 0x00080000 },
+#else
+	{ kRAMa_Size, kRAMb_Size },
+#endif
+};
+
+#define RAMBankSizesN (sizeof(RAMBankSizes) / sizeof(RAMBankSizes[0]))
+
+/*
+	Pick the largest way that fits in both RAMSizeRequest and
+	this build, or the smallest way that fits this build if
+	none is small enough. Called before RAM is allocated.
+*/
+GLOBALPROC RAM_ChooseSize(void)
+{
+	int i;
+
+	RAMa_Size = kRAMa_Size;
+	RAMb_Size = kRAMb_Size;
+	if (0 != RAMSizeRequest) {
+		for (i = 0; i < RAMBankSizesN; ++i) {
+			if ((RAMBankSizes[i][0] <= kRAMa_Size)
+				&& (RAMBankSizes[i][1] <= kRAMb_Size))
+			{
+				RAMa_Size = RAMBankSizes[i][0];
+				RAMb_Size = RAMBankSizes[i][1];
+				if (RAM_Size <= RAMSizeRequest) {
+					break;
+				}
+			}
+		}
+	}
+}
 
 #if EmVidCard
 GLOBALVAR ui3p VidROM = nullpr;
@@ -132,6 +186,10 @@ GLOBALVAR ui3b Wires[kNumWires];
 IMPORTPROC m68k_WantDisasmContext(void);
 #endif
 
+#if WantTraceRing
+IMPORTPROC m68k_TraceRingDump(void);
+#endif
+
 #if WantDisasm
 GLOBALPROC dbglog_StartLine(void)
 {
@@ -221,6 +279,9 @@ GLOBALPROC DoReportAbnormalID(ui4r id
 #endif
 
 	if (! GotOneAbnormal) {
+#if WantTraceRing
+		m68k_TraceRingDump();
+#endif
 		WarnMsgAbnormalID(id);
 #if ReportAbnormalInterrupt
 		SetInterruptButton(trueblnr);
@@ -258,6 +319,7 @@ GLOBALPROC DoReportAbnormalID(ui4r id
 #define kSCSI_ln2Spc 19
 #endif
 
+
 #define kRAM_Overlay_Base 0x00600000 /* when overlay on */
 #define kRAM_Overlay_Top  0x00800000
 
@@ -661,26 +723,43 @@ GLOBALPROC Extn_Reset(void)
 #error "Overlay_ROM_CmpZeroMask not defined"
 #endif
 
-enum {
-	kMMDV_VIA1,
+FORWARDFUNC ui5b MMDV_VIA1Access(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
 #if EmVIA2
-	kMMDV_VIA2,
+FORWARDFUNC ui5b MMDV_VIA2Access(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
 #endif
-	kMMDV_SCC,
-	kMMDV_Extn,
+FORWARDFUNC ui5b MMDV_SCCAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
+FORWARDFUNC ui5b MMDV_ExtnAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
 #if EmASC
-	kMMDV_ASC,
+FORWARDFUNC ui5b MMDV_ASCAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
 #endif
-	kMMDV_SCSI,
-	kMMDV_IWM,
+FORWARDFUNC ui5b MMDV_SCSIAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
+FORWARDFUNC ui5b MMDV_IWMAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
 
-	kNumMMDVs
-};
+/*
+	the SCSI and IWM handlers only touch their own state, unless
+	an abnormal report raises an interrupt, or ram is reached
+	through the cpu emulation.
+*/
+#if ReportAbnormalInterrupt || defined(ln2mtb)
+#define kMMDVCpuFree 0
+#else
+#define kMMDVCpuFree kATTA_mmdvcpufreemask
+#endif
 
 enum {
 #if CurEmMd >= kEmMd_SE
 	kMAN_OverlayOff,
 #endif
+#if ScreenWriteTracked
+	kMAN_VidMemWrite,
+#endif
 
 	kNumMANs
 };
@@ -706,6 +785,55 @@ LOCALPROC InitATTList(void)
 	LastATTel = 0;
 }
 
+#if ScreenWriteTracked
+/*
+	Video memory is mapped as kVidMemTrackN pages, each with
+	its own ATT element. A page starts out write protected,
+	so the first write to it goes through MemAccessNtfy,
+	which marks it dirty and makes it writable. Later writes
+	to the page are as fast as to any other memory, until
+	VidMemTrack_TakeDirty protects it again at the end of
+	the tick.
+*/
+
+#if ! IncludeVidMem
+#error "ScreenWriteTracked needs IncludeVidMem"
+#endif
+#if kVidMemRAM_Size > 0x00100000
+#error "ScreenWriteTracked not supported for this kVidMemRAM_Size"
+#endif
+
+#define kVidMemTrackN 32
+#define kVidMemTrackPageSize (kVidMemRAM_Size / kVidMemTrackN)
+
+LOCALVAR ui5b VidMemTrackDirty = 0;
+LOCALVAR ATTep VidMemTrackATT[kVidMemTrackN];
+#endif
+
+#if IncludeVidMem
+LOCALPROC AddVidMemToATTList(ATTep p)
+{
+#if ScreenWriteTracked
+	ATTer r;
+	int i;
+
+	r.cmpmask = p->cmpmask
+		| (p->usemask & ~ (kVidMemTrackPageSize - 1));
+	r.usemask = kVidMemTrackPageSize - 1;
+	r.Access = kATTA_readreadymask | kATTA_ntfymask;
+	r.Ntfy = kMAN_VidMemWrite;
+	for (i = 0; i < kVidMemTrackN; ++i) {
+		r.cmpvalu = p->cmpvalu + i * kVidMemTrackPageSize;
+		r.usebase = p->usebase + i * kVidMemTrackPageSize;
+		VidMemTrackATT[i] = &ATTListA[LastATTel];
+		AddToATTList(&r);
+	}
+#else
+	AddToATTList(p);
+#endif
+}
+#endif
+
 LOCALPROC FinishATTList(void)
 {
 	{
@@ -762,37 +890,32 @@ LOCALPROC SetUp_RAM24(void)
 	ATTer r;
 	ui5r bankbit = 0x00100000 << (((VIA2_iA7 << 1) | VIA2_iA6) << 1);
 
-#if kRAMa_Size == kRAMb_Size
-	if (kRAMa_Size == bankbit) {
+	if ((RAMa_Size == RAMb_Size) && (RAMa_Size == bankbit)) {
 		/* properly set up balanced RAM */
 		r.cmpmask = 0x00FFFFFF & ~ ((1 << kRAM_ln2Spc) - 1);
 		r.cmpvalu = 0;
-		r.usemask = ((1 << kRAM_ln2Spc) - 1) & (kRAM_Size - 1);
+		r.usemask = ((1 << kRAM_ln2Spc) - 1) & (RAM_Size - 1);
 		r.usebase = RAM;
 		r.Access = kATTA_readwritereadymask;
 		AddToATTList(&r);
-	} else
-#endif
-	{
+	} else {
 		bankbit &= 0x00FFFFFF; /* if too large, always use RAMa */
 
-		if (0 != bankbit) {
-#if kRAMb_Size != 0
+		if ((0 != bankbit) && (0 != RAMb_Size)) {
 			r.cmpmask = bankbit
 				| (0x00FFFFFF & ~ ((1 << kRAM_ln2Spc) - 1));
 			r.cmpvalu = bankbit;
-			r.usemask = ((1 << kRAM_ln2Spc) - 1) & (kRAMb_Size - 1);
-			r.usebase = kRAMa_Size + RAM;
+			r.usemask = ((1 << kRAM_ln2Spc) - 1) & (RAMb_Size - 1);
+			r.usebase = RAMa_Size + RAM;
 			r.Access = kATTA_readwritereadymask;
 			AddToATTList(&r);
-#endif
 		}
 
 		{
 			r.cmpmask = bankbit
 				| (0x00FFFFFF & ~ ((1 << kRAM_ln2Spc) - 1));
 			r.cmpvalu = 0;
-			r.usemask = ((1 << kRAM_ln2Spc) - 1) & (kRAMa_Size - 1);
+			r.usemask = ((1 << kRAM_ln2Spc) - 1) & (RAMa_Size - 1);
 			r.usebase = RAM;
 			r.Access = kATTA_readwritereadymask;
 			AddToATTList(&r);
@@ -815,7 +938,7 @@ LOCALPROC SetUp_io(void)
 	}
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_VIA1;
+	r.MMDVproc = MMDV_VIA1Access;
 	AddToATTList(&r);
 
 	if (Addr32) {
@@ -827,7 +950,7 @@ LOCALPROC SetUp_io(void)
 	}
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_VIA2;
+	r.MMDVproc = MMDV_VIA2Access;
 	AddToATTList(&r);
 
 	if (Addr32) {
@@ -839,7 +962,7 @@ LOCALPROC SetUp_io(void)
 	}
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_SCC;
+	r.MMDVproc = MMDV_SCCAccess;
 	AddToATTList(&r);
 
 	if (Addr32) {
@@ -851,7 +974,7 @@ LOCALPROC SetUp_io(void)
 	}
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_Extn;
+	r.MMDVproc = MMDV_ExtnAccess;
 	AddToATTList(&r);
 
 	if (Addr32) {
@@ -862,8 +985,8 @@ LOCALPROC SetUp_io(void)
 		r.cmpvalu = 0x00F00000 | 0x10000;
 	}
 	r.usebase = nullpr;
-	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_SCSI;
+	r.Access = kATTA_mmdvmask | kMMDVCpuFree;
+	r.MMDVproc = MMDV_SCSIAccess;
 	AddToATTList(&r);
 
 	if (Addr32) {
@@ -875,7 +998,7 @@ LOCALPROC SetUp_io(void)
 	}
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_ASC;
+	r.MMDVproc = MMDV_ASCAccess;
 	AddToATTList(&r);
 
 	if (Addr32) {
@@ -886,8 +1009,8 @@ LOCALPROC SetUp_io(void)
 		r.cmpvalu = 0x00F00000 | 0x16000;
 	}
 	r.usebase = nullpr;
-	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_IWM;
+	r.Access = kATTA_mmdvmask | kMMDVCpuFree;
+	r.MMDVproc = MMDV_IWMAccess;
 	AddToATTList(&r);
 
 #if 0
@@ -944,7 +1067,7 @@ LOCALPROC SetUp_address24(void)
 	r.usemask = (kVidMemRAM_Size - 1) & (0x100000 - 1);
 	r.usebase = VidMem;
 	r.Access = kATTA_readwritereadymask;
-	AddToATTList(&r);
+	AddVidMemToATTList(&r);
 #if kVidMemRAM_Size >= 0x00200000
 	r.cmpmask = 0x00FFFFFF & ~ (0x100000 - 1);
 	r.cmpvalu = 0xA00000;
@@ -987,30 +1110,27 @@ LOCALPROC SetUp_address32(void)
 	} else {
 		ui5r bankbit =
 			0x00100000 << (((VIA2_iA7 << 1) | VIA2_iA6) << 1);
-#if kRAMa_Size == kRAMb_Size
-		if (kRAMa_Size == bankbit) {
+		if ((RAMa_Size == RAMb_Size) && (RAMa_Size == bankbit)) {
 			/* properly set up balanced RAM */
 			r.cmpmask = ~ ((1 << 30) - 1);
 			r.cmpvalu = 0;
-			r.usemask = kRAM_Size - 1;
+			r.usemask = RAM_Size - 1;
 			r.usebase = RAM;
 			r.Access = kATTA_readwritereadymask;
 			AddToATTList(&r);
-		} else
-#endif
-		{
-#if kRAMb_Size != 0
-			r.cmpmask = bankbit | ~ ((1 << 30) - 1);
-			r.cmpvalu = bankbit;
-			r.usemask = kRAMb_Size - 1;
-			r.usebase = kRAMa_Size + RAM;
-			r.Access = kATTA_readwritereadymask;
-			AddToATTList(&r);
-#endif
+		} else {
+			if (0 != RAMb_Size) {
+				r.cmpmask = bankbit | ~ ((1 << 30) - 1);
+				r.cmpvalu = bankbit;
+				r.usemask = RAMb_Size - 1;
+				r.usebase = RAMa_Size + RAM;
+				r.Access = kATTA_readwritereadymask;
+				AddToATTList(&r);
+			}
 
 			r.cmpmask = bankbit | ~ ((1 << 30) - 1);
 			r.cmpvalu = 0;
-			r.usemask = kRAMa_Size - 1;
+			r.usemask = RAMa_Size - 1;
 			r.usebase = RAM;
 			r.Access = kATTA_readwritereadymask;
 			AddToATTList(&r);
@@ -1056,7 +1176,7 @@ LOCALPROC SetUp_address32(void)
 	r.usemask = 0x000FFFFF & (kVidMemRAM_Size - 1);
 	r.usebase = VidMem;
 	r.Access = kATTA_readwritereadymask;
-	AddToATTList(&r);
+	AddVidMemToATTList(&r);
 /* kludge to allow more than 1M of Video Memory */
 #if kVidMemRAM_Size >= 0x00200000
 	r.cmpmask = ~ 0x000FFFFF;
@@ -1139,33 +1259,32 @@ LOCALPROC SetUp_RAM24(void)
 {
 	ATTer r;
 
-#if (0 == kRAMb_Size) || (kRAMa_Size == kRAMb_Size)
-	r.cmpmask = 0x00FFFFFF & ~ ((1 << kRAM_ln2Spc) - 1);
-	r.cmpvalu = kRAM_Base;
-	r.usemask = kRAM_Size - 1;
-	r.usebase = RAM;
-	r.Access = kATTA_readwritereadymask;
-	AddToATTListWithMTB(&r);
-#else
-	/* unbalanced memory */
-
-#if 0 != (0x00FFFFFF & kRAMa_Size)
-	/* condition should always be true if configuration file right */
-	r.cmpmask = 0x00FFFFFF & (kRAMa_Size | ~ ((1 << kRAM_ln2Spc) - 1));
-	r.cmpvalu = kRAM_Base + kRAMa_Size;
-	r.usemask = kRAMb_Size - 1;
-	r.usebase = kRAMa_Size + RAM;
-	r.Access = kATTA_readwritereadymask;
-	AddToATTListWithMTB(&r);
-#endif
+	if ((0 == RAMb_Size) || (RAMa_Size == RAMb_Size)) {
+		r.cmpmask = 0x00FFFFFF & ~ ((1 << kRAM_ln2Spc) - 1);
+		r.cmpvalu = kRAM_Base;
+		r.usemask = RAM_Size - 1;
+		r.usebase = RAM;
+		r.Access = kATTA_readwritereadymask;
+		AddToATTListWithMTB(&r);
+	} else {
+		/* unbalanced memory */
 
-	r.cmpmask = 0x00FFFFFF & (kRAMa_Size | ~ ((1 << kRAM_ln2Spc) - 1));
-	r.cmpvalu = kRAM_Base;
-	r.usemask = kRAMa_Size - 1;
-	r.usebase = RAM;
-	r.Access = kATTA_readwritereadymask;
-	AddToATTListWithMTB(&r);
-#endif
+		r.cmpmask = 0x00FFFFFF
+			& (RAMa_Size | ~ ((1 << kRAM_ln2Spc) - 1));
+		r.cmpvalu = kRAM_Base + RAMa_Size;
+		r.usemask = RAMb_Size - 1;
+		r.usebase = RAMa_Size + RAM;
+		r.Access = kATTA_readwritereadymask;
+		AddToATTListWithMTB(&r);
+
+		r.cmpmask = 0x00FFFFFF
+			& (RAMa_Size | ~ ((1 << kRAM_ln2Spc) - 1));
+		r.cmpvalu = kRAM_Base;
+		r.usemask = RAMa_Size - 1;
+		r.usebase = RAM;
+		r.Access = kATTA_readwritereadymask;
+		AddToATTListWithMTB(&r);
+	}
 }
 #endif
 
@@ -1206,17 +1325,16 @@ LOCALPROC SetUp_address(void)
 	if (MemOverlay) {
 		r.cmpmask = 0x00E00000;
 		r.cmpvalu = kRAM_Overlay_Base;
-#if (0 == kRAMb_Size) || (kRAMa_Size == kRAMb_Size)
-		r.usemask = kRAM_Size - 1;
-			/* note that cmpmask and usemask overlap for 4M */
-		r.usebase = RAM;
-		r.Access = kATTA_readwritereadymask;
-#else
-		/* unbalanced memory */
-		r.usemask = kRAMb_Size - 1;
-		r.usebase = kRAMa_Size + RAM;
+		if ((0 == RAMb_Size) || (RAMa_Size == RAMb_Size)) {
+			r.usemask = RAM_Size - 1;
+				/* note that cmpmask and usemask overlap for 4M */
+			r.usebase = RAM;
+		} else {
+			/* unbalanced memory */
+			r.usemask = RAMb_Size - 1;
+			r.usebase = RAMa_Size + RAM;
+		}
 		r.Access = kATTA_readwritereadymask;
-#endif
 		AddToATTListWithMTB(&r);
 	}
 
@@ -1226,28 +1344,28 @@ LOCALPROC SetUp_address(void)
 	r.usemask = kVidMemRAM_Size - 1;
 	r.usebase = VidMem;
 	r.Access = kATTA_readwritereadymask;
-	AddToATTList(&r);
+	AddVidMemToATTList(&r);
 #endif
 
 	r.cmpmask = 0x00FFFFFF & ~ ((1 << kVIA1_ln2Spc) - 1);
 	r.cmpvalu = kVIA1_Block_Base;
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_VIA1;
+	r.MMDVproc = MMDV_VIA1Access;
 	AddToATTList(&r);
 
 	r.cmpmask = 0x00FFFFFF & ~ ((1 << kSCC_ln2Spc) - 1);
 	r.cmpvalu = kSCCRd_Block_Base;
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_SCC;
+	r.MMDVproc = MMDV_SCCAccess;
 	AddToATTList(&r);
 
 	r.cmpmask = 0x00FFFFFF & ~ ((1 << kExtn_ln2Spc) - 1);
 	r.cmpvalu = kExtn_Block_Base;
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_Extn;
+	r.MMDVproc = MMDV_ExtnAccess;
 	AddToATTList(&r);
 
 #if CurEmMd == kEmMd_PB100
@@ -1255,22 +1373,22 @@ LOCALPROC SetUp_address(void)
 	r.cmpvalu = kASC_Block_Base;
 	r.usebase = nullpr;
 	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_ASC;
+	r.MMDVproc = MMDV_ASCAccess;
 	AddToATTList(&r);
 #endif
 
 	r.cmpmask = 0x00FFFFFF & ~ ((1 << kSCSI_ln2Spc) - 1);
 	r.cmpvalu = kSCSI_Block_Base;
 	r.usebase = nullpr;
-	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_SCSI;
+	r.Access = kATTA_mmdvmask | kMMDVCpuFree;
+	r.MMDVproc = MMDV_SCSIAccess;
 	AddToATTList(&r);
 
 	r.cmpmask = 0x00FFFFFF & ~ ((1 << kIWM_ln2Spc) - 1);
 	r.cmpvalu = kIWM_Block_Base;
 	r.usebase = nullpr;
-	r.Access = kATTA_mmdvmask;
-	r.MMDV = kMMDV_IWM;
+	r.Access = kATTA_mmdvmask | kMMDVCpuFree;
+	r.MMDVproc = MMDV_IWMAccess;
 	AddToATTList(&r);
 }
 #endif
@@ -1295,231 +1413,253 @@ LOCALPROC get_fail_realblock(ATTep p)
 }
 #endif
 
-GLOBALFUNC ui5b MMDV_Access(ATTep p, ui5b Data,
+LOCALFUNC ui5b MMDV_VIA1Access(ATTep p, ui5b Data,
 	blnr WriteMem, blnr ByteSize, CPTR addr)
 {
-	switch (p->MMDV) {
-		case kMMDV_VIA1:
-			if (! ByteSize) {
+	if (! ByteSize) {
 #if (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-				if (WriteMem && (addr == 0xF40006)) {
-					/* for weirdness on shutdown in System 6 */
+		if (WriteMem && (addr == 0xF40006)) {
+			/* for weirdness on shutdown in System 6 */
 #if 0
-					VIA1_Access((Data >> 8) & 0x00FF, WriteMem,
-							(addr >> 9) & kVIA1_Mask);
-					VIA1_Access((Data) & 0x00FF, WriteMem,
-							(addr >> 9) & kVIA1_Mask);
+			VIA1_Access((Data >> 8) & 0x00FF, WriteMem,
+					(addr >> 9) & kVIA1_Mask);
+			VIA1_Access((Data) & 0x00FF, WriteMem,
+					(addr >> 9) & kVIA1_Mask);
 #endif
-				} else
+		} else
 #endif
-				{
-					ReportAbnormalID(0x1106, "access VIA1 word");
-				}
-			} else if ((addr & 1) != 0) {
-				ReportAbnormalID(0x1107, "access VIA1 odd");
-			} else {
+		{
+			ReportAbnormalID(0x1106, "access VIA1 word");
+		}
+	} else if ((addr & 1) != 0) {
+		ReportAbnormalID(0x1107, "access VIA1 odd");
+	} else {
 #if CurEmMd != kEmMd_PB100
 #if (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-				if ((addr & 0x000001FE) != 0x00000000)
+		if ((addr & 0x000001FE) != 0x00000000)
 #else
-				if ((addr & 0x000FE1FE) != 0x000FE1FE)
+		if ((addr & 0x000FE1FE) != 0x000FE1FE)
 #endif
-				{
-					ReportAbnormalID(0x1108,
-						"access VIA1 nonstandard address");
-				}
+		{
+			ReportAbnormalID(0x1108,
+				"access VIA1 nonstandard address");
+		}
 #endif
-				Data = VIA1_Access(Data, WriteMem,
-					(addr >> 9) & kVIA1_Mask);
-			}
+		Data = VIA1_Access(Data, WriteMem,
+			(addr >> 9) & kVIA1_Mask);
+	}
+
+	return Data;
+}
 
-			break;
 #if EmVIA2
-		case kMMDV_VIA2:
-			if (! ByteSize) {
-				if ((! WriteMem)
-					&& ((0x3e00 == (addr & 0x1FFFF))
-						|| (0x3e02 == (addr & 0x1FFFF))))
-				{
-					/* for weirdness at offset 0x71E in ROM */
-					Data =
-						(VIA2_Access(Data, WriteMem,
-							(addr >> 9) & kVIA2_Mask) << 8)
-						| VIA2_Access(Data, WriteMem,
-							(addr >> 9) & kVIA2_Mask);
-
-				} else {
-					ReportAbnormalID(0x1109, "access VIA2 word");
-				}
-			} else if ((addr & 1) != 0) {
-				if (0x3FFF == (addr & 0x1FFFF)) {
-					/*
-						for weirdness at offset 0x7C4 in ROM.
-						looks like bug.
-					*/
-					Data = VIA2_Access(Data, WriteMem,
-						(addr >> 9) & kVIA2_Mask);
-				} else {
-					ReportAbnormalID(0x110A, "access VIA2 odd");
-				}
-			} else {
-				if ((addr & 0x000001FE) != 0x00000000) {
-					ReportAbnormalID(0x110B,
-						"access VIA2 nonstandard address");
-				}
-				Data = VIA2_Access(Data, WriteMem,
+LOCALFUNC ui5b MMDV_VIA2Access(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr)
+{
+	if (! ByteSize) {
+		if ((! WriteMem)
+			&& ((0x3e00 == (addr & 0x1FFFF))
+				|| (0x3e02 == (addr & 0x1FFFF))))
+		{
+			/* for weirdness at offset 0x71E in ROM */
+			Data =
+				(VIA2_Access(Data, WriteMem,
+					(addr >> 9) & kVIA2_Mask) << 8)
+				| VIA2_Access(Data, WriteMem,
 					(addr >> 9) & kVIA2_Mask);
-			}
-			break;
+
+		} else {
+			ReportAbnormalID(0x1109, "access VIA2 word");
+		}
+	} else if ((addr & 1) != 0) {
+		if (0x3FFF == (addr & 0x1FFFF)) {
+			/*
+				for weirdness at offset 0x7C4 in ROM.
+				looks like bug.
+			*/
+			Data = VIA2_Access(Data, WriteMem,
+				(addr >> 9) & kVIA2_Mask);
+		} else {
+			ReportAbnormalID(0x110A, "access VIA2 odd");
+		}
+	} else {
+		if ((addr & 0x000001FE) != 0x00000000) {
+			ReportAbnormalID(0x110B,
+				"access VIA2 nonstandard address");
+		}
+		Data = VIA2_Access(Data, WriteMem,
+			(addr >> 9) & kVIA2_Mask);
+	}
+
+	return Data;
+}
 #endif
-		case kMMDV_SCC:
 
+LOCALFUNC ui5b MMDV_SCCAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr)
+{
 #if (CurEmMd >= kEmMd_SE) \
 	&& ! ((CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx))
 
-			if ((addr & 0x00100000) == 0) {
-				ReportAbnormalID(0x110C,
-					"access SCC unassigned address");
-			} else
+	if ((addr & 0x00100000) == 0) {
+		ReportAbnormalID(0x110C,
+			"access SCC unassigned address");
+	} else
 #endif
-			if (! ByteSize) {
-				ReportAbnormalID(0x110D, "Attemped Phase Adjust");
-			} else
+	if (! ByteSize) {
+		ReportAbnormalID(0x110D, "Attemped Phase Adjust");
+	} else
 #if ! ((CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx))
-			if (WriteMem != ((addr & 1) != 0)) {
-				if (WriteMem) {
+	if (WriteMem != ((addr & 1) != 0)) {
+		if (WriteMem) {
 #if CurEmMd >= kEmMd_512Ke
 #if CurEmMd != kEmMd_PB100
-					ReportAbnormalID(0x110E, "access SCC even/odd");
-					/*
-						This happens on boot with 64k ROM.
-					*/
+			ReportAbnormalID(0x110E, "access SCC even/odd");
+			/*
+				This happens on boot with 64k ROM.
+			*/
 #endif
 #endif
-				} else {
-					SCC_Reset();
-				}
-			} else
+		} else {
+			SCC_Reset();
+		}
+	} else
 #endif
 #if (CurEmMd != kEmMd_PB100) \
 	&& ! ((CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx))
 
-			if (WriteMem != (addr >= kSCCWr_Block_Base)) {
-				ReportAbnormalID(0x110F, "access SCC wr/rd base wrong");
-			} else
+	if (WriteMem != (addr >= kSCCWr_Block_Base)) {
+		ReportAbnormalID(0x110F, "access SCC wr/rd base wrong");
+	} else
 #endif
-			{
+	{
 #if CurEmMd != kEmMd_PB100
 #if (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-				if ((addr & 0x1FF9) != 0x00000000)
+		if ((addr & 0x1FF9) != 0x00000000)
 #else
-				if ((addr & 0x001FFFF8) != 0x001FFFF8)
+		if ((addr & 0x001FFFF8) != 0x001FFFF8)
 #endif
-				{
-					ReportAbnormalID(0x1110,
-						"access SCC nonstandard address");
-				}
+		{
+			ReportAbnormalID(0x1110,
+				"access SCC nonstandard address");
+		}
 #endif
-				Data = SCC_Access(Data, WriteMem,
-					(addr >> 1) & kSCC_Mask);
-			}
-			break;
-		case kMMDV_Extn:
-			if (ByteSize) {
-				ReportAbnormalID(0x1111, "access Sony byte");
-			} else if ((addr & 1) != 0) {
-				ReportAbnormalID(0x1112, "access Sony odd");
-			} else if (! WriteMem) {
-				ReportAbnormalID(0x1113, "access Sony read");
-			} else {
-				Extn_Access(Data, (addr >> 1) & 0x0F);
-			}
-			break;
+		Data = SCC_Access(Data, WriteMem,
+			(addr >> 1) & kSCC_Mask);
+	}
+
+	return Data;
+}
+
+LOCALFUNC ui5b MMDV_ExtnAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr)
+{
+	if (ByteSize) {
+		ReportAbnormalID(0x1111, "access Sony byte");
+	} else if ((addr & 1) != 0) {
+		ReportAbnormalID(0x1112, "access Sony odd");
+	} else if (! WriteMem) {
+		ReportAbnormalID(0x1113, "access Sony read");
+	} else {
+		Extn_Access(Data, (addr >> 1) & 0x0F);
+	}
+
+	return Data;
+}
+
 #if EmASC
-		case kMMDV_ASC:
-			if (! ByteSize) {
+LOCALFUNC ui5b MMDV_ASCAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr)
+{
+	if (! ByteSize) {
 #if (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-				if (WriteMem) {
-					(void) ASC_Access((Data >> 8) & 0x00FF,
-						WriteMem, addr & kASC_Mask);
-					Data = ASC_Access((Data) & 0x00FF,
-						WriteMem, (addr + 1) & kASC_Mask);
-				} else {
-					Data =
-						(ASC_Access((Data >> 8) & 0x00FF,
-							WriteMem, addr & kASC_Mask) << 8)
-						| ASC_Access((Data) & 0x00FF,
-							WriteMem, (addr + 1) & kASC_Mask);
-				}
+		if (WriteMem) {
+			(void) ASC_Access((Data >> 8) & 0x00FF,
+				WriteMem, addr & kASC_Mask);
+			Data = ASC_Access((Data) & 0x00FF,
+				WriteMem, (addr + 1) & kASC_Mask);
+		} else {
+			Data =
+				(ASC_Access((Data >> 8) & 0x00FF,
+					WriteMem, addr & kASC_Mask) << 8)
+				| ASC_Access((Data) & 0x00FF,
+					WriteMem, (addr + 1) & kASC_Mask);
+		}
 #else
-				ReportAbnormalID(0x1114, "access ASC word");
+		ReportAbnormalID(0x1114, "access ASC word");
 #endif
-			} else {
-				Data = ASC_Access(Data, WriteMem, addr & kASC_Mask);
-			}
-			break;
+	} else {
+		Data = ASC_Access(Data, WriteMem, addr & kASC_Mask);
+	}
+
+	return Data;
+}
 #endif
-		case kMMDV_SCSI:
-			if (! ByteSize) {
-				ReportAbnormalID(0x1115, "access SCSI word");
-			} else
+
+LOCALFUNC ui5b MMDV_SCSIAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr)
+{
+	if (! ByteSize) {
+		ReportAbnormalID(0x1115, "access SCSI word");
+	} else
 #if ! ((CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx))
-			if (WriteMem != ((addr & 1) != 0)) {
-				ReportAbnormalID(0x1116, "access SCSI even/odd");
-			} else
+	if (WriteMem != ((addr & 1) != 0)) {
+		ReportAbnormalID(0x1116, "access SCSI even/odd");
+	} else
 #endif
-			{
+	{
 #if (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-				if ((addr & 0x1F8F) != 0x00000000) {
-					ReportAbnormalID(0x1117,
-						"access SCSI nonstandard address");
-				}
+		if ((addr & 0x1F8F) != 0x00000000) {
+			ReportAbnormalID(0x1117,
+				"access SCSI nonstandard address");
+		}
 #endif
-				Data = SCSI_Access(Data, WriteMem, (addr >> 4) & 0x07);
-			}
+		Data = SCSI_Access(Data, WriteMem, (addr >> 4) & 0x07);
+	}
 
-			break;
-		case kMMDV_IWM:
+	return Data;
+}
+
+LOCALFUNC ui5b MMDV_IWMAccess(ATTep p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr)
+{
 #if (CurEmMd >= kEmMd_SE) \
 	&& ! ((CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx))
 
-			if ((addr & 0x00100000) == 0) {
-				ReportAbnormalID(0x1118,
-					"access IWM unassigned address");
-			} else
+	if ((addr & 0x00100000) == 0) {
+		ReportAbnormalID(0x1118,
+			"access IWM unassigned address");
+	} else
 #endif
-			if (! ByteSize) {
+	if (! ByteSize) {
 #if ExtraAbnormalReports
-				ReportAbnormalID(0x1119, "access IWM word");
-				/*
-					This happens when quitting 'Glider 3.1.2'.
-					perhaps a bad handle is being disposed of.
-				*/
+		ReportAbnormalID(0x1119, "access IWM word");
+		/*
+			This happens when quitting 'Glider 3.1.2'.
+			perhaps a bad handle is being disposed of.
+		*/
 #endif
-			} else
+	} else
 #if (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-			if ((addr & 1) != 0) {
-				ReportAbnormalID(0x111A, "access IWM odd");
-			} else
+	if ((addr & 1) != 0) {
+		ReportAbnormalID(0x111A, "access IWM odd");
+	} else
 #else
-			if ((addr & 1) == 0) {
-				ReportAbnormalID(0x111B, "access IWM even");
-			} else
+	if ((addr & 1) == 0) {
+		ReportAbnormalID(0x111B, "access IWM even");
+	} else
 #endif
-			{
+	{
 #if (CurEmMd != kEmMd_PB100) \
 	&& ! ((CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx))
 
-				if ((addr & 0x001FE1FF) != 0x001FE1FF) {
-					ReportAbnormalID(0x111C,
-						"access IWM nonstandard address");
-				}
+		if ((addr & 0x001FE1FF) != 0x001FE1FF) {
+			ReportAbnormalID(0x111C,
+				"access IWM nonstandard address");
+		}
 #endif
-				Data = IWM_Access(Data, WriteMem,
-					(addr >> 9) & kIWM_Mask);
-			}
-
-			break;
+		Data = IWM_Access(Data, WriteMem,
+			(addr >> 9) & kIWM_Mask);
 	}
 
 	return Data;
@@ -1541,11 +1681,65 @@ GLOBALFUNC blnr MemAccessNtfy(ATTep pT)
 
 			break;
 #endif
+#if ScreenWriteTracked
+		case kMAN_VidMemWrite:
+			VidMemTrackDirty |= (ui5b)1
+				<< ((pT->usebase - VidMem) / kVidMemTrackPageSize);
+			pT->Access = kATTA_readwritereadymask;
+
+			v = trueblnr;
+
+			break;
+#endif
 	}
 
 	return v;
 }
 
+#if ScreenWriteTracked
+GLOBALPROC VidMemTrack_AllDirty(void)
+{
+	VidMemTrackDirty = ~ (ui5b)0;
+}
+#endif
+
+#if ScreenWriteTracked
+/*
+	Gets the range of video memory written to since the
+	last call, and write protects it again.
+*/
+GLOBALFUNC blnr VidMemTrack_TakeDirty(ui5r *Start, ui5r *End)
+{
+	int i;
+	int j0 = -1;
+	int j1 = 0;
+	ui5b Dirty = VidMemTrackDirty;
+
+	if (0 == Dirty) {
+		return falseblnr;
+	}
+
+	for (i = 0; i < kVidMemTrackN; ++i) {
+		if (0 != (Dirty & ((ui5b)1 << i))) {
+			if (j0 < 0) {
+				j0 = i;
+			}
+			j1 = i + 1;
+			if (nullpr != VidMemTrackATT[i]) {
+				VidMemTrackATT[i]->Access =
+					kATTA_readreadymask | kATTA_ntfymask;
+			}
+		}
+	}
+	VidMemTrackDirty = 0;
+	m68k_ATTAccessChngNtfy();
+
+	*Start = j0 * kVidMemTrackPageSize;
+	*End = j1 * kVidMemTrackPageSize;
+	return trueblnr;
+}
+#endif
+
 GLOBALPROC MemOverlay_ChangeNtfy(void)
 {
 #if CurEmMd <= kEmMd_Plus
@@ -1719,21 +1913,141 @@ GLOBALFUNC blnr FindKeyEvent(int *VirtualKey, blnr *KeyDown)
 #include <stdio.h>
 #endif
 
+/*
+	The fixed tasks, below kNumICTs, are kept as a bitmask and
+	a time each, which PROGMAIN.c scans, since for so few that
+	is as fast as anything. Events handed out by ICT_NewEvent,
+	to devices that supply their own procedure, are kept in a
+	binary heap ordered by when they are due, so that adding,
+	cancelling, and finding the next one costs about log2 of
+	the number pending. Each id has at most one pending time,
+	and setting it again moves it. Nothing is allocated after
+	startup.
+*/
+
 GLOBALVAR uimr ICTactive;
 GLOBALVAR iCountt ICTwhen[kNumICTs];
 
-GLOBALPROC ICT_Zap(void)
+#if kNumICTEvents > 255
+#error "kNumICTEvents too big"
+#endif
+
+LOCALVAR iCountt ICTEvtWhen[kNumICTEvents];
+LOCALVAR ICTproc ICTEvtProcs[kNumICTEvents];
+LOCALVAR ui3b ICTheap[kNumICTEvents];
+LOCALVAR ui3b ICTheapPos[kNumICTEvents];
+	/* index in ICTheap plus one, or zero if not pending */
+GLOBALVAR uimr ICTheapN = 0;
+
+GLOBALVAR iCountt NextiCount = 0;
+
+/*
+	Everything pending is due at or after NextiCount, so
+	comparing distances from it orders events correctly even
+	when the count wraps around. Ties go to the lower event.
+*/
+LOCALFUNC blnr ICT_Before(int a, int b)
 {
-	ICTactive = 0;
+	ui5b da = ICTEvtWhen[a] - NextiCount;
+	ui5b db = ICTEvtWhen[b] - NextiCount;
+
+	return (da < db) || ((da == db) && (a < b));
+}
+
+LOCALPROC ICT_HeapSet(uimr i, int e)
+{
+	ICTheap[i] = e;
+	ICTheapPos[e] = i + 1;
+}
+
+LOCALPROC ICT_SiftUp(uimr i)
+{
+	int e = ICTheap[i];
+	uimr parent;
+
+	while (i > 0) {
+		parent = (i - 1) >> 1;
+		if (! ICT_Before(e, ICTheap[parent])) {
+			break;
+		}
+		ICT_HeapSet(i, ICTheap[parent]);
+		i = parent;
+	}
+	ICT_HeapSet(i, e);
+}
+
+LOCALPROC ICT_SiftDown(uimr i)
+{
+	int e = ICTheap[i];
+	uimr child;
+
+	for (; ; ) {
+		child = (i << 1) + 1;
+		if (child >= ICTheapN) {
+			break;
+		}
+		if ((child + 1 < ICTheapN)
+			&& ICT_Before(ICTheap[child + 1], ICTheap[child]))
+		{
+			++child;
+		}
+		if (! ICT_Before(ICTheap[child], e)) {
+			break;
+		}
+		ICT_HeapSet(i, ICTheap[child]);
+		i = child;
+	}
+	ICT_HeapSet(i, e);
+}
+
+LOCALPROC ICT_Remove(int e)
+{
+	uimr i = ICTheapPos[e] - 1;
+
+	ICTheapPos[e] = 0;
+	--ICTheapN;
+	if (i != ICTheapN) {
+		ICT_HeapSet(i, ICTheap[ICTheapN]);
+		if ((i > 0) && ICT_Before(ICTheap[i], ICTheap[(i - 1) >> 1])) {
+			ICT_SiftUp(i);
+		} else {
+			ICT_SiftDown(i);
+		}
+	}
 }
 
 LOCALPROC InsertICT(int taskid, iCountt when)
 {
-	ICTwhen[taskid] = when;
-	ICTactive |= (1 << taskid);
+	int e;
+
+	if (taskid < kNumICTs) {
+		ICTwhen[taskid] = when;
+		ICTactive |= (1 << taskid);
+	} else {
+		e = taskid - kNumICTs;
+		if (0 != ICTheapPos[e]) {
+			ICT_Remove(e);
+		}
+		ICTEvtWhen[e] = when;
+		ICTheap[ICTheapN] = e;
+		ICT_SiftUp(ICTheapN++);
+
+		if (ICT_Before(e, ICTheap[0])) {
+			ReportAbnormalID(0x111E, "ICT heap root not next due");
+		}
+	}
 }
 
-GLOBALVAR iCountt NextiCount = 0;
+GLOBALPROC ICT_Zap(void)
+{
+	int i;
+
+	ICTactive = 0;
+	for (i = 0; i < kNumICTEvents; ++i) {
+		ICTheapPos[i] = 0;
+	}
+	ICTheapN = 0;
+}
 
 GLOBALFUNC iCountt GetCuriCount(void)
 {
@@ -1749,10 +2063,96 @@ GLOBALPROC ICT_add(int taskid, ui5b n)
 #ifdef _VIA_Debug
 	fprintf(stderr, "ICT_add: %d, %d, %d\n", when, taskid, n);
 #endif
-	InsertICT(taskid, when);
-
 	if (x > (si5r)n) {
+		/*
+			Shorten the slice before inserting, so that
+			everything pending is at or after NextiCount,
+			as ICT_Before needs.
+		*/
 		SetCyclesRemaining(n);
 		NextiCount = when;
 	}
+
+	InsertICT(taskid, when);
+}
+
+GLOBALPROC ICT_Cancel(int taskid)
+{
+	/*
+		If this was what the current slice of cycles stops
+		for, the slice just ends with nothing to do.
+	*/
+	if (taskid < kNumICTs) {
+		ICTactive &= ~ (1 << taskid);
+	} else if (0 != ICTheapPos[taskid - kNumICTs]) {
+		ICT_Remove(taskid - kNumICTs);
+	}
+}
+
+GLOBALFUNC blnr ICT_IsPending(int taskid)
+{
+	if (taskid < kNumICTs) {
+		return 0 != (ICTactive & (1 << taskid));
+	} else {
+		return 0 != ICTheapPos[taskid - kNumICTs];
+	}
+}
+
+GLOBALFUNC int ICT_NewEvent(ICTproc p)
+{
+	int i;
+
+	for (i = 0; i < kNumICTEvents; ++i) {
+		if (nullpr == ICTEvtProcs[i]) {
+			ICTEvtProcs[i] = p;
+			return kNumICTs + i;
+		}
+	}
+
+	ReportAbnormalID(0x111D, "out of ICT event slots");
+	return -1;
+}
+
+GLOBALPROC ICT_DisposeEvent(int taskid)
+{
+	ICT_Cancel(taskid);
+	ICTEvtProcs[taskid - kNumICTs] = nullpr;
+}
+
+/*
+	The next event that is due now, taken off the heap, or -1.
+	Only worth calling when ICTheapN is not zero.
+*/
+GLOBALFUNC int ICT_TakeDueEvent(void)
+{
+	int e;
+
+	if ((0 == ICTheapN) || (ICTEvtWhen[ICTheap[0]] != NextiCount)) {
+		return -1;
+	}
+
+	e = ICTheap[0];
+	ICT_Remove(e);
+
+	return kNumICTs + e;
+}
+
+GLOBALPROC ICT_DoEvent(int taskid)
+{
+	ICTEvtProcs[taskid - kNumICTs]();
+}
+
+GLOBALFUNC ui5b ICT_EventTimeToNext(ui5b maxn)
+{
+	ui5b d;
+
+	if (0 != ICTheapN) {
+		d = ICTEvtWhen[ICTheap[0]] - NextiCount;
+		/* at this point d must be > 0 */
+		if (d < maxn) {
+			return d;
+		}
+	}
+
+	return maxn;
 }
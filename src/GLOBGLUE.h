@@ -36,12 +36,21 @@
 #define RAMSafetyMarginFudge 4
 
 #define kRAM_Size (kRAMa_Size + kRAMb_Size)
+	/* the most RAM this build allows */
+
+EXPORTVAR(ui5r, RAMa_Size)
+EXPORTVAR(ui5r, RAMb_Size)
+#define RAM_Size (RAMa_Size + RAMb_Size)
+	/* set by RAM_ChooseSize, at most kRAMa_Size and kRAMb_Size */
+
+EXPORTPROC RAM_ChooseSize(void);
+
 EXPORTVAR(ui3p, RAM)
 	/*
 		allocated by MYOSGLUE to be at least
-			kRAM_Size + RAMSafetyMarginFudge
+			RAM_Size + RAMSafetyMarginFudge
 		bytes. Because of shortcuts taken in GLOBGLUE.c, it is in theory
-		possible for the emulator to write up to 3 bytes past kRAM_Size.
+		possible for the emulator to write up to 3 bytes past RAM_Size.
 	*/
 
 #if EmVidCard
@@ -171,7 +180,21 @@ enum {
 	kNumICTs
 };
 
+#ifndef kNumICTEvents /* slots for ICT_NewEvent */
+#define kNumICTEvents 16
+#endif
+
+typedef void (*ICTproc)(void);
+
 EXPORTPROC ICT_add(int taskid, ui5b n);
+EXPORTPROC ICT_Cancel(int taskid);
+EXPORTFUNC blnr ICT_IsPending(int taskid);
+EXPORTFUNC int ICT_NewEvent(ICTproc p);
+EXPORTPROC ICT_DisposeEvent(int taskid);
+
+EXPORTFUNC int ICT_TakeDueEvent(void);
+EXPORTPROC ICT_DoEvent(int taskid);
+EXPORTFUNC ui5b ICT_EventTimeToNext(ui5b maxn);
 
 #define iCountt ui5b
 EXPORTFUNC iCountt GetCuriCount(void);
@@ -179,6 +202,7 @@ EXPORTPROC ICT_Zap(void);
 
 EXPORTVAR(uimr, ICTactive)
 EXPORTVAR(iCountt, ICTwhen[kNumICTs])
+EXPORTVAR(uimr, ICTheapN)
 EXPORTVAR(iCountt, NextiCount)
 
 EXPORTVAR(ui3b, Wires[kNumWires])
@@ -240,6 +264,16 @@ EXPORTPROC Extn_Reset(void);
 
 EXPORTPROC customreset(void);
 
+struct ATTer;
+
+/*
+	memory mapped device handler, called directly from the
+	cpu emulation for an ATTer with kATTA_mmdvmask set. it
+	gets the entry, so usebase can serve as a context pointer.
+*/
+typedef ui5b (*ATTMMDVproc)(struct ATTer *p, ui5b Data,
+	blnr WriteMem, blnr ByteSize, CPTR addr);
+
 struct ATTer {
 	struct ATTer *Next;
 	ui5r cmpmask;
@@ -247,10 +281,10 @@ struct ATTer {
 	ui5r Access;
 	ui5r usemask; /* Should be one less than a power of two. */
 	ui3p usebase;
-	ui3r MMDV;
+	ATTMMDVproc MMDVproc;
 	ui3r Ntfy;
-	ui4r Pad0;
-	ui5r Pad1; /* make 32 byte structure, on 32 bit systems */
+	ui3r Pad0;
+	ui4r Pad1; /* make 32 byte structure, on 32 bit systems */
 };
 typedef struct ATTer ATTer;
 typedef ATTer *ATTep;
@@ -259,6 +293,11 @@ typedef ATTer *ATTep;
 #define kATTA_writereadybit 1
 #define kATTA_mmdvbit 2
 #define kATTA_ntfybit 3
+#define kATTA_mmdvcpufreebit 4
+	/*
+		the handler doesn't touch the cpu emulation state,
+		so with HaveGlbReg the registers need not be saved
+	*/
 
 #define kATTA_readwritereadymask \
 	((1 << kATTA_readreadybit) | (1 << kATTA_writereadybit))
@@ -266,7 +305,11 @@ typedef ATTer *ATTep;
 #define kATTA_writereadymask (1 << kATTA_writereadybit)
 #define kATTA_mmdvmask (1 << kATTA_mmdvbit)
 #define kATTA_ntfymask (1 << kATTA_ntfybit)
+#define kATTA_mmdvcpufreemask (1 << kATTA_mmdvcpufreebit)
 
-EXPORTFUNC ui5b MMDV_Access(ATTep p, ui5b Data,
-	blnr WriteMem, blnr ByteSize, CPTR addr);
 EXPORTFUNC blnr MemAccessNtfy(ATTep pT);
+
+#if ScreenWriteTracked
+EXPORTPROC VidMemTrack_AllDirty(void);
+EXPORTFUNC blnr VidMemTrack_TakeDirty(ui5r *Start, ui5r *End);
+#endif
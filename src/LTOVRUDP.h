@@ -0,0 +1,326 @@
+/*
+	LTOVRUDP.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	LocalTalk OVeR UDP
+
+	Carries LLAP frames in UDP datagrams sent to a multicast
+	group, so that any number of emulators on the same network
+	share one LocalTalk segment, without the raw Ethernet access
+	that BPFILTER.h needs. Each datagram is a 4 byte sender id,
+	so an emulator can recognize its own packets when they loop
+	back, followed by the LLAP frame.
+
+	A receive thread waits on the socket, and each time it wakes
+	reads every datagram that is waiting into a ring of slots,
+	stamping each with the time it arrived. LT_ReceivePacket only
+	ever takes from the ring, so the emulation never makes a
+	socket call to receive. The thread is the only writer of
+	LTUDP_Head and the emulation the only writer of LTUDP_Tail,
+	so no lock is needed. A packet that has waited in the ring
+	longer than kLTUDPMaxAgeMs is dropped rather than delivered,
+	since by then the node that sent it has given up on it, and
+	answering it would only confuse the exchange it has moved on
+	to.
+*/
+
+#ifndef kLTUDPGroup /* 239.192.76.84 */
+#define kLTUDPGroup 0xEFC04C54
+#endif
+
+#ifndef kLTUDPPort
+#define kLTUDPPort 1954
+#endif
+
+#ifndef kLTUDPMaxAgeMs
+#define kLTUDPMaxAgeMs 250
+#endif
+
+#ifndef kLTUDPWaitMs /* how often the receive thread checks to quit */
+#define kLTUDPWaitMs 100
+#endif
+
+#define kLTUDPln2RingN 4
+#define kLTUDPRingN (1 << kLTUDPln2RingN)
+#define kLTUDPRingMask (kLTUDPRingN - 1)
+
+#define kLTUDPHdrSz 4
+
+#define kLTUDPSocBufSz 0x100000
+
+#ifndef dbglog_LTUDP
+#define dbglog_LTUDP (0 && dbglog_HAVE)
+#endif
+
+typedef struct {
+	ui5r TimeMs;
+	ui5r Sz; /* including the header */
+	ui3b Data[kLTUDPHdrSz + LT_TxBfMxSz];
+} LTUDP_Slot;
+
+LOCALVAR LTUDP_Slot LTUDP_Ring[kLTUDPRingN];
+LOCALVAR volatile ui5r LTUDP_Head = 0; /* written by the thread */
+LOCALVAR volatile ui5r LTUDP_Tail = 0; /* written by the emulation */
+LOCALVAR blnr LTUDP_Holding = falseblnr;
+	/* the slot at LTUDP_Tail is what LT_RxBuffer points into */
+
+LOCALVAR volatile blnr LTUDP_Quit = falseblnr;
+LOCALVAR Thread LTUDP_Thread = NULL;
+LOCALVAR int LTUDP_fd = -1;
+LOCALVAR u32 *LTUDP_SocBuf = NULL;
+LOCALVAR struct sockaddr_in LTUDP_GroupAddr;
+
+/* for tuning, never cleared */
+LOCALVAR ui5r LTUDP_TxCount = 0;
+LOCALVAR ui5r LTUDP_RxCount = 0;
+LOCALVAR volatile ui5r LTUDP_FullCount = 0;
+LOCALVAR ui5r LTUDP_StaleCount = 0;
+LOCALVAR ui5r LTUDP_WorstAgeMs = 0;
+
+LOCALVAR ui3b LTUDP_TxBuffer[kLTUDPHdrSz + LT_TxBfMxSz];
+
+GLOBALVAR ui3p LT_TxBuffer = NULL;
+GLOBALVAR ui4r LT_TxBuffSz = 0;
+
+GLOBALVAR ui3p LT_RxBuffer = NULL;
+GLOBALVAR ui5r LT_RxBuffSz = 0;
+
+LOCALFUNC ui5r LTUDP_NowMs(void)
+{
+	return (ui5r)(svcGetSystemTick() / (SYSCLOCK_ARM11 / 1000));
+}
+
+LOCALFUNC blnr LTUDP_IsFromMe(ui3p p)
+{
+	return (p[0] == LTUDP_TxBuffer[0])
+		&& (p[1] == LTUDP_TxBuffer[1])
+		&& (p[2] == LTUDP_TxBuffer[2])
+		&& (p[3] == LTUDP_TxBuffer[3]);
+}
+
+/* read everything waiting on the socket, called by the thread */
+LOCALPROC LTUDP_ReadBatch(void)
+{
+	LTUDP_Slot *s;
+	ui5r Head = LTUDP_Head;
+	ssize_t n;
+	ui3b Discard[kLTUDPHdrSz + LT_TxBfMxSz];
+
+	for (;;) {
+		if (((Head - LTUDP_Tail) & ~ (ui5r)kLTUDPRingMask) != 0) {
+			/* full, keep the older packets */
+			n = recvfrom(LTUDP_fd, Discard, sizeof(Discard),
+				MSG_DONTWAIT, NULL, NULL);
+			if (n <= 0) {
+				break;
+			}
+			++LTUDP_FullCount;
+		} else {
+			s = &LTUDP_Ring[Head & kLTUDPRingMask];
+			n = recvfrom(LTUDP_fd, s->Data, sizeof(s->Data),
+				MSG_DONTWAIT, NULL, NULL);
+			if (n <= 0) {
+				break;
+			}
+			if ((n > kLTUDPHdrSz) && ! LTUDP_IsFromMe(s->Data)) {
+				s->Sz = n;
+				s->TimeMs = LTUDP_NowMs();
+				++Head;
+				__sync_synchronize();
+				LTUDP_Head = Head;
+			}
+		}
+	}
+}
+
+LOCALPROC LTUDP_ThreadMain(void *arg)
+{
+	struct pollfd pfd;
+
+	(void)arg; /* unused */
+
+	pfd.fd = LTUDP_fd;
+	pfd.events = POLLIN;
+
+	while (! LTUDP_Quit) {
+		pfd.revents = 0;
+		if ((poll(&pfd, 1, kLTUDPWaitMs) > 0)
+			&& (0 != (pfd.revents & POLLIN)))
+		{
+			LTUDP_ReadBatch();
+		}
+	}
+}
+
+LOCALFUNC blnr LTUDP_OpenSocket(void)
+{
+	struct sockaddr_in a;
+	struct ip_mreq mreq;
+	int v = 1;
+
+	LTUDP_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (LTUDP_fd < 0) {
+		return falseblnr;
+	}
+
+	(void) setsockopt(LTUDP_fd, SOL_SOCKET, SO_REUSEADDR,
+		&v, sizeof(v));
+
+	memset(&a, 0, sizeof(a));
+	a.sin_family = AF_INET;
+	a.sin_port = htons(kLTUDPPort);
+	a.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(LTUDP_fd, (struct sockaddr *)&a, sizeof(a)) < 0) {
+		return falseblnr;
+	}
+
+	mreq.imr_multiaddr.s_addr = htonl(kLTUDPGroup);
+	mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+	if (setsockopt(LTUDP_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+		&mreq, sizeof(mreq)) < 0)
+	{
+		return falseblnr;
+	}
+
+	(void) fcntl(LTUDP_fd, F_SETFL,
+		fcntl(LTUDP_fd, F_GETFL, 0) | O_NONBLOCK);
+
+	memset(&LTUDP_GroupAddr, 0, sizeof(LTUDP_GroupAddr));
+	LTUDP_GroupAddr.sin_family = AF_INET;
+	LTUDP_GroupAddr.sin_port = htons(kLTUDPPort);
+	LTUDP_GroupAddr.sin_addr.s_addr = htonl(kLTUDPGroup);
+
+	return trueblnr;
+}
+
+LOCALPROC UnInitLocalTalk(void)
+{
+	if (NULL != LTUDP_Thread) {
+		LTUDP_Quit = trueblnr;
+		(void) threadJoin(LTUDP_Thread, U64_MAX);
+		threadFree(LTUDP_Thread);
+		LTUDP_Thread = NULL;
+	}
+	if (LTUDP_fd >= 0) {
+		(void) close(LTUDP_fd);
+		LTUDP_fd = -1;
+	}
+	if (NULL != LTUDP_SocBuf) {
+		(void) socExit();
+		free(LTUDP_SocBuf);
+		LTUDP_SocBuf = NULL;
+	}
+
+#if dbglog_LTUDP
+	dbglog_writeCStr("LTUDP tx ");
+	dbglog_writeNum(LTUDP_TxCount);
+	dbglog_writeCStr(" rx ");
+	dbglog_writeNum(LTUDP_RxCount);
+	dbglog_writeCStr(" full ");
+	dbglog_writeNum(LTUDP_FullCount);
+	dbglog_writeCStr(" stale ");
+	dbglog_writeNum(LTUDP_StaleCount);
+	dbglog_writeCStr(" worst age ");
+	dbglog_writeNum(LTUDP_WorstAgeMs);
+	dbglog_writeReturn();
+#endif
+}
+
+/*
+	Without a network the emulated machine just sees a
+	LocalTalk segment with nobody else on it, so this
+	only fails if memory runs out.
+*/
+LOCALFUNC blnr InitLocalTalk(void)
+{
+	ui5r id = (ui5r)svcGetSystemTick();
+	s32 prio = 0x30;
+
+	LTUDP_TxBuffer[0] = id >> 24;
+	LTUDP_TxBuffer[1] = id >> 16;
+	LTUDP_TxBuffer[2] = id >> 8;
+	LTUDP_TxBuffer[3] = id;
+	LT_TxBuffer = &LTUDP_TxBuffer[kLTUDPHdrSz];
+
+	LTUDP_SocBuf = (u32 *)memalign(0x1000, kLTUDPSocBufSz);
+	if (NULL == LTUDP_SocBuf) {
+		return falseblnr;
+	}
+	if (R_FAILED(socInit(LTUDP_SocBuf, kLTUDPSocBufSz))) {
+		free(LTUDP_SocBuf);
+		LTUDP_SocBuf = NULL;
+	} else if (! LTUDP_OpenSocket()) {
+		UnInitLocalTalk();
+	} else {
+		/*
+			run above the emulation, so packets are taken
+			off the socket as soon as they arrive
+		*/
+		(void) svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+		LTUDP_Thread = threadCreate(LTUDP_ThreadMain, NULL,
+			0x4000, prio - 1, -2, falseblnr);
+		if (NULL == LTUDP_Thread) {
+			UnInitLocalTalk();
+		}
+	}
+
+	return trueblnr;
+}
+
+GLOBALOSGLUPROC LT_TransmitPacket(void)
+{
+	if (NULL != LTUDP_Thread) {
+		(void) sendto(LTUDP_fd, LTUDP_TxBuffer,
+			kLTUDPHdrSz + LT_TxBuffSz, 0,
+			(struct sockaddr *)&LTUDP_GroupAddr,
+			sizeof(LTUDP_GroupAddr));
+		++LTUDP_TxCount;
+	}
+}
+
+GLOBALOSGLUPROC LT_ReceivePacket(void)
+{
+	LTUDP_Slot *s;
+	ui5r Age;
+	ui5r Now;
+
+	if (LTUDP_Holding) {
+		/* the SCC is done with the previous packet */
+		__sync_synchronize();
+		++LTUDP_Tail;
+		LTUDP_Holding = falseblnr;
+	}
+
+	if (LTUDP_Tail != LTUDP_Head) {
+		Now = LTUDP_NowMs();
+		__sync_synchronize();
+		do {
+			s = &LTUDP_Ring[LTUDP_Tail & kLTUDPRingMask];
+			Age = Now - s->TimeMs;
+			if (Age <= kLTUDPMaxAgeMs) {
+				if (Age > LTUDP_WorstAgeMs) {
+					LTUDP_WorstAgeMs = Age;
+				}
+				LT_RxBuffer = &s->Data[kLTUDPHdrSz];
+				LT_RxBuffSz = s->Sz - kLTUDPHdrSz;
+				LTUDP_Holding = trueblnr;
+				++LTUDP_RxCount;
+				return;
+			}
+			++LTUDP_StaleCount;
+			__sync_synchronize();
+			++LTUDP_Tail;
+		} while (LTUDP_Tail != LTUDP_Head);
+	}
+}
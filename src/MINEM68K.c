@@ -103,6 +103,25 @@ typedef MATCr *MATCp;
 #define USE_PCLIMIT 1
 #endif
 
+#ifndef UseThreadedDispatch
+#define UseThreadedDispatch 0
+#endif
+
+/*
+	With USE_PCLIMIT, pc_pHi is kept this many bytes before
+	the end of the block the pc is in, and is only checked
+	when fetching an opcode. Below it the whole instruction
+	is in the block, so the rest of it is fetched with no
+	checks. Must be at least the longest instruction.
+*/
+#ifndef kPCGuard
+#if Use68020
+#define kPCGuard 24
+#else
+#define kPCGuard 12
+#endif
+#endif
+
 #define AKMemory 0
 #define AKRegister 1
 
@@ -156,6 +175,33 @@ typedef void (my_reg_call *ArgSetDstP)(ui5r f);
 #define HaveGlbReg 0
 #endif
 
+#if ! HaveGlbReg
+/*
+	so that a build for another host, such as
+	tools/M68BENCH.c, can just define HaveGlbReg to 0
+*/
+#undef r_regs
+#undef r_pc_p
+#undef r_MaxCyclesToGo
+#undef r_pc_pHi
+#endif
+
+/*
+	There is one emulated CPU, and the core is tied to this
+	one static regstruct. Without r_regs, V_regs is regs
+	itself. With r_regs the instructions go through g_regs,
+	but Em_Swap still keeps the global registers in regs,
+	and loads g_regs from regs.save_regs, which
+	MINEM68K_Init sets to &regs. m68k_TraceRingDump and
+	MINEM68K_ReserveAlloc also name regs. Not all of the CPU
+	state is in regs either: the FPU registers are in fpu_dat
+	(FPCPEMDV.h), the rounding mode and exception flags are
+	globals in FPMATHEM.h, and TraceRing, the TrapProf_
+	variables and DumpTable are separate. Outside the core,
+	the memory map, the devices and the glue are all single
+	instance globals.
+*/
+
 LOCALVAR struct regstruct
 {
 	ui5r regs[16]; /* Data and Address registers */
@@ -199,6 +245,9 @@ LOCALVAR struct regstruct
 	si5r MoreCyclesToGo;
 	si5r ResidualCycles;
 	ui3b fakeword[2];
+#if USE_PCLIMIT
+	ui4b pcstage[kPCGuard / 2]; /* see Recalc_PC_Stage */
+#endif
 
 	/* Status Register */
 	ui5r intmask; /* bits 10-8 : interrupt priority mask */
@@ -230,6 +279,9 @@ LOCALVAR struct regstruct
 #ifdef r_regs
 	struct regstruct *save_regs;
 #endif
+#if WantTraceRing
+	ui5r TraceIn;
+#endif
 
 	CPTR usp; /* User Stack Pointer */
 	CPTR isp; /* Interrupt Stack Pointer */
@@ -307,23 +359,73 @@ register ui3p g_pc_pHi asm (r_pc_pHi);
 LOCALVAR ui5b DumpTable[kNumIKinds];
 #endif
 
+/*
+	The trace ring keeps the last TraceRing_N instructions
+	executed, as binary records, for m68k_TraceRingDump to
+	save along with RAM and ROM. Turning the records into
+	text is left to tools/M68TRACE.c, on the host.
+*/
+
+#ifndef WantTraceRing
+#define WantTraceRing 0
+#endif
+
+#if WantTraceRing
+#ifndef TraceRing_ln2N
+#define TraceRing_ln2N 16
+#endif
+#define TraceRing_N (1 << TraceRing_ln2N)
+#define TraceRing_Mask (TraceRing_N - 1)
+
+/*
+	Cycles is MaxCyclesToGo before the fetch. Storing it as is
+	rather than as a running total keeps the work per
+	instruction down, so whenever MaxCyclesToGo is changed by
+	something other than running instructions, a marker record
+	with an odd pc notes the change, in opcode, and the tool
+	puts the running total back together.
+*/
+
+typedef struct {
+	ui5b pc;
+	ui5b Cycles;
+	ui5b opcode;
+} TraceRec;
+
+#define kTraceRecMarker 1
+
+LOCALVAR TraceRec TraceRing[TraceRing_N];
+
+/* call before MaxCyclesToGo is changed by x */
+LOCALPROC TraceRing_AdjCycles(si5r x)
+{
+	TraceRec *t = &TraceRing[V_regs.TraceIn];
+
+	t->pc = kTraceRecMarker;
+	t->Cycles = V_MaxCyclesToGo;
+	t->opcode = x;
+	V_regs.TraceIn = (V_regs.TraceIn + 1) & TraceRing_Mask;
+}
+#else
+#define TraceRing_AdjCycles(x)
+#endif
+
 #if USE_PCLIMIT
 FORWARDPROC Recalc_PC_Block(void);
-FORWARDFUNC ui5r my_reg_call Recalc_PC_BlockReturnUi5r(ui5r v);
 #endif
 
+/*
+	The instruction fetches need no checks, the opcode
+	fetch in m68k_go_MaxCycles makes sure the whole
+	instruction can be read from V_pc_p on. (kPCGuard)
+*/
+
 LOCALINLINEFUNC ui4r nextiword(void)
 /* NOT sign extended */
 {
 	ui4r r = do_get_mem_word(V_pc_p);
 	V_pc_p += 2;
 
-#if USE_PCLIMIT
-	if (my_cond_rare(V_pc_p >= V_pc_pHi)) {
-		Recalc_PC_Block();
-	}
-#endif
-
 	return r;
 }
 
@@ -332,12 +434,6 @@ LOCALINLINEFUNC ui5r nextiSByte(void)
 	ui5r r = ui5r_FromSByte(do_get_mem_byte(V_pc_p + 1));
 	V_pc_p += 2;
 
-#if USE_PCLIMIT
-	if (my_cond_rare(V_pc_p >= V_pc_pHi)) {
-		return Recalc_PC_BlockReturnUi5r(r);
-	}
-#endif
-
 	return r;
 }
 
@@ -347,41 +443,20 @@ LOCALINLINEFUNC ui5r nextiSWord(void)
 	ui5r r = ui5r_FromSWord(do_get_mem_word(V_pc_p));
 	V_pc_p += 2;
 
-#if USE_PCLIMIT
-	if (my_cond_rare(V_pc_p >= V_pc_pHi)) {
-		return Recalc_PC_BlockReturnUi5r(r);
-	}
-#endif
-
 	return r;
 }
 
-FORWARDFUNC ui5r nextilong_ext(void);
-
 LOCALINLINEFUNC ui5r nextilong(void)
 {
 	ui5r r = do_get_mem_long(V_pc_p);
 	V_pc_p += 4;
 
-#if USE_PCLIMIT
-	/* could be two words in different blocks */
-	if (my_cond_rare(V_pc_p >= V_pc_pHi)) {
-		r = nextilong_ext();
-	}
-#endif
-
 	return r;
 }
 
 LOCALINLINEPROC BackupPC(void)
 {
 	V_pc_p -= 2;
-
-#if USE_PCLIMIT
-	if (my_cond_rare(V_pc_p < V_regs.pc_pLo)) {
-		Recalc_PC_Block();
-	}
-#endif
 }
 
 LOCALINLINEFUNC CPTR m68k_getpc(void)
@@ -564,194 +639,309 @@ FORWARDPROC DoCodeFPU_dflt(void);
 
 typedef void (*func_pointer_t)(void);
 
-LOCALVAR const func_pointer_t OpDispatch[kNumIKinds + 1] = {
-	DoCodeTst /* kIKindTst */,
-	DoCodeCmpB /* kIKindCmpB */,
-	DoCodeCmpW /* kIKindCmpW */,
-	DoCodeCmpL /* kIKindCmpL */,
-	DoCodeBccB /* kIKindBccB */,
-	DoCodeBccW /* kIKindBccW */,
-	DoCodeBraB /* kIKindBraB */,
-	DoCodeBraW /* kIKindBraW */,
-	DoCodeDBcc /* kIKindDBcc */,
-	DoCodeDBF /* kIKindDBF */,
-	DoCodeSwap /* kIKindSwap */,
-	DoCodeMoveL /* kIKindMoveL */,
-	DoCodeMoveW /* kIKindMoveW */,
-	DoCodeMoveB /* kIKindMoveB */,
-	DoCodeMoveA /* kIKindMoveAL */,
-	DoCodeMoveA /* kIKindMoveAW */,
-	DoCodeMoveQ /* kIKindMoveQ */,
-	DoCodeAddB /* kIKindAddB */,
-	DoCodeAddW /* kIKindAddW */,
-	DoCodeAddL /* kIKindAddL */,
-	DoCodeSubB /* kIKindSubB */,
-	DoCodeSubW /* kIKindSubW */,
-	DoCodeSubL /* kIKindSubL */,
-	DoCodeLea /* kIKindLea */,
-	DoCodePEA /* kIKindPEA */,
-	DoCodeA /* kIKindA */,
-	DoCodeBsrB /* kIKindBsrB */,
-	DoCodeBsrW /* kIKindBsrW */,
-	DoCodeJsr /* kIKindJsr */,
-	DoCodeLinkA6 /* kIKindLinkA6 */,
-	DoCodeMOVEMRmML /* kIKindMOVEMRmML */,
-	DoCodeMOVEMApRL /* kIKindMOVEMApRL */,
-	DoCodeUnlkA6 /* kIKindUnlkA6 */,
-	DoCodeRts /* kIKindRts */,
-	DoCodeJmp /* kIKindJmp */,
-	DoCodeClr /* kIKindClr */,
-	DoCodeAddA /* kIKindAddA */,
-	DoCodeAddA /* kIKindAddQA */,
-	DoCodeSubA /* kIKindSubA */,
-	DoCodeSubA /* kIKindSubQA */,
-	DoCodeCmpA /* kIKindCmpA */,
-	DoCodeAddXB /* kIKindAddXB */,
-	DoCodeAddXW /* kIKindAddXW */,
-	DoCodeAddXL /* kIKindAddXL */,
-	DoCodeSubXB /* kIKindSubXB */,
-	DoCodeSubXW /* kIKindSubXW */,
-	DoCodeSubXL /* kIKindSubXL */,
-	DoCodeAslB /* kIKindAslB */,
-	DoCodeAslW /* kIKindAslW */,
-	DoCodeAslL /* kIKindAslL */,
-	DoCodeAsrB /* kIKindAsrB */,
-	DoCodeAsrW /* kIKindAsrW */,
-	DoCodeAsrL /* kIKindAsrL */,
-	DoCodeLslB /* kIKindLslB */,
-	DoCodeLslW /* kIKindLslW */,
-	DoCodeLslL /* kIKindLslL */,
-	DoCodeLsrB /* kIKindLsrB */,
-	DoCodeLsrW /* kIKindLsrW */,
-	DoCodeLsrL /* kIKindLsrL */,
-	DoCodeRxlB /* kIKindRxlB */,
-	DoCodeRxlW /* kIKindRxlW */,
-	DoCodeRxlL /* kIKindRxlL */,
-	DoCodeRxrB /* kIKindRxrB */,
-	DoCodeRxrW /* kIKindRxrW */,
-	DoCodeRxrL /* kIKindRxrL */,
-	DoCodeRolB /* kIKindRolB */,
-	DoCodeRolW /* kIKindRolW */,
-	DoCodeRolL /* kIKindRolL */,
-	DoCodeRorB /* kIKindRorB */,
-	DoCodeRorW /* kIKindRorW */,
-	DoCodeRorL /* kIKindRorL */,
-	DoCodeBTstB /* kIKindBTstB */,
-	DoCodeBChgB /* kIKindBChgB */,
-	DoCodeBClrB /* kIKindBClrB */,
-	DoCodeBSetB /* kIKindBSetB */,
-	DoCodeBTstL /* kIKindBTstL */,
-	DoCodeBChgL /* kIKindBChgL */,
-	DoCodeBClrL /* kIKindBClrL */,
-	DoCodeBSetL /* kIKindBSetL */,
-	DoCodeAnd /* kIKindAndI */,
-	DoCodeAnd /* kIKindAndEaD */,
-	DoCodeAnd /* kIKindAndDEa */,
-	DoCodeOr /* kIKindOrI */,
-	DoCodeOr /* kIKindOrDEa */,
-	DoCodeOr /* kIKindOrEaD */,
-	DoCodeEor /* kIKindEor */,
-	DoCodeEor /* kIKindEorI */,
-	DoCodeNot /* kIKindNot */,
-	DoCodeScc /* kIKindScc */,
-	DoCodeNegXB /* kIKindNegXB */,
-	DoCodeNegXW /* kIKindNegXW */,
-	DoCodeNegXL /* kIKindNegXL */,
-	DoCodeNegB /* kIKindNegB */,
-	DoCodeNegW /* kIKindNegW */,
-	DoCodeNegL /* kIKindNegL */,
-	DoCodeEXTW /* kIKindEXTW */,
-	DoCodeEXTL /* kIKindEXTL */,
-	DoCodeMulU /* kIKindMulU */,
-	DoCodeMulS /* kIKindMulS */,
-	DoCodeDivU /* kIKindDivU */,
-	DoCodeDivS /* kIKindDivS */,
-	DoCodeExg /* kIKindExg */,
-	DoCodeMoveEaCR /* kIKindMoveEaCCR */,
-	DoCodeMoveSREa /* kIKindMoveSREa */,
-	DoCodeMoveEaSR /* kIKindMoveEaSR */,
-	DoCodeOrISR /* kIKindOrISR */,
-	DoCodeAndISR /* kIKindAndISR */,
-	DoCodeEorISR /* kIKindEorISR */,
-	DoCodeOrICCR /* kIKindOrICCR */,
-	DoCodeAndICCR /* kIKindAndICCR */,
-	DoCodeEorICCR /* kIKindEorICCR */,
-	DoCodeMOVEMApRW /* kIKindMOVEMApRW */,
-	DoCodeMOVEMRmMW /* kIKindMOVEMRmMW */,
-	DoCodeMOVEMrmW /* kIKindMOVEMrmW */,
-	DoCodeMOVEMrmL /* kIKindMOVEMrmL */,
-	DoCodeMOVEMmrW /* kIKindMOVEMmrW */,
-	DoCodeMOVEMmrL /* kIKindMOVEMmrL */,
-	DoCodeAbcd /* kIKindAbcd */,
-	DoCodeSbcd /* kIKindSbcd */,
-	DoCodeNbcd /* kIKindNbcd */,
-	DoCodeRte /* kIKindRte */,
-	DoCodeNop /* kIKindNop */,
-	DoCodeMoveP0 /* kIKindMoveP0 */,
-	DoCodeMoveP1 /* kIKindMoveP1 */,
-	DoCodeMoveP2 /* kIKindMoveP2 */,
-	DoCodeMoveP3 /* kIKindMoveP3 */,
-	op_illg /* kIKindIllegal */,
-	DoCodeChk /* kIKindChkW */,
-	DoCodeTrap /* kIKindTrap */,
-	DoCodeTrapV /* kIKindTrapV */,
-	DoCodeRtr /* kIKindRtr */,
-	DoCodeLink /* kIKindLink */,
-	DoCodeUnlk /* kIKindUnlk */,
-	DoCodeMoveRUSP /* kIKindMoveRUSP */,
-	DoCodeMoveUSPR /* kIKindMoveUSPR */,
-	DoCodeTas /* kIKindTas */,
-	DoCodeFdefault /* kIKindFdflt */,
-	DoCodeStop /* kIKindStop */,
-	DoCodeReset /* kIKindReset */,
+/*
+	The handler of each instruction kind, in the order of
+	the kinds in M68KITAB.h, as X(handler, kind), so both
+	OpDispatch and the threaded dispatch of
+	m68k_go_MaxCycles can be made from it.
+*/
+
+#define OpDispatchList68000(X) \
+	X(DoCodeTst, kIKindTst) \
+	X(DoCodeCmpB, kIKindCmpB) \
+	X(DoCodeCmpW, kIKindCmpW) \
+	X(DoCodeCmpL, kIKindCmpL) \
+	X(DoCodeBccB, kIKindBccB) \
+	X(DoCodeBccW, kIKindBccW) \
+	X(DoCodeBraB, kIKindBraB) \
+	X(DoCodeBraW, kIKindBraW) \
+	X(DoCodeDBcc, kIKindDBcc) \
+	X(DoCodeDBF, kIKindDBF) \
+	X(DoCodeSwap, kIKindSwap) \
+	X(DoCodeMoveL, kIKindMoveL) \
+	X(DoCodeMoveW, kIKindMoveW) \
+	X(DoCodeMoveB, kIKindMoveB) \
+	X(DoCodeMoveA, kIKindMoveAL) \
+	X(DoCodeMoveA, kIKindMoveAW) \
+	X(DoCodeMoveQ, kIKindMoveQ) \
+	X(DoCodeAddB, kIKindAddB) \
+	X(DoCodeAddW, kIKindAddW) \
+	X(DoCodeAddL, kIKindAddL) \
+	X(DoCodeSubB, kIKindSubB) \
+	X(DoCodeSubW, kIKindSubW) \
+	X(DoCodeSubL, kIKindSubL) \
+	X(DoCodeLea, kIKindLea) \
+	X(DoCodePEA, kIKindPEA) \
+	X(DoCodeA, kIKindA) \
+	X(DoCodeBsrB, kIKindBsrB) \
+	X(DoCodeBsrW, kIKindBsrW) \
+	X(DoCodeJsr, kIKindJsr) \
+	X(DoCodeLinkA6, kIKindLinkA6) \
+	X(DoCodeMOVEMRmML, kIKindMOVEMRmML) \
+	X(DoCodeMOVEMApRL, kIKindMOVEMApRL) \
+	X(DoCodeUnlkA6, kIKindUnlkA6) \
+	X(DoCodeRts, kIKindRts) \
+	X(DoCodeJmp, kIKindJmp) \
+	X(DoCodeClr, kIKindClr) \
+	X(DoCodeAddA, kIKindAddA) \
+	X(DoCodeAddA, kIKindAddQA) \
+	X(DoCodeSubA, kIKindSubA) \
+	X(DoCodeSubA, kIKindSubQA) \
+	X(DoCodeCmpA, kIKindCmpA) \
+	X(DoCodeAddXB, kIKindAddXB) \
+	X(DoCodeAddXW, kIKindAddXW) \
+	X(DoCodeAddXL, kIKindAddXL) \
+	X(DoCodeSubXB, kIKindSubXB) \
+	X(DoCodeSubXW, kIKindSubXW) \
+	X(DoCodeSubXL, kIKindSubXL) \
+	X(DoCodeAslB, kIKindAslB) \
+	X(DoCodeAslW, kIKindAslW) \
+	X(DoCodeAslL, kIKindAslL) \
+	X(DoCodeAsrB, kIKindAsrB) \
+	X(DoCodeAsrW, kIKindAsrW) \
+	X(DoCodeAsrL, kIKindAsrL) \
+	X(DoCodeLslB, kIKindLslB) \
+	X(DoCodeLslW, kIKindLslW) \
+	X(DoCodeLslL, kIKindLslL) \
+	X(DoCodeLsrB, kIKindLsrB) \
+	X(DoCodeLsrW, kIKindLsrW) \
+	X(DoCodeLsrL, kIKindLsrL) \
+	X(DoCodeRxlB, kIKindRxlB) \
+	X(DoCodeRxlW, kIKindRxlW) \
+	X(DoCodeRxlL, kIKindRxlL) \
+	X(DoCodeRxrB, kIKindRxrB) \
+	X(DoCodeRxrW, kIKindRxrW) \
+	X(DoCodeRxrL, kIKindRxrL) \
+	X(DoCodeRolB, kIKindRolB) \
+	X(DoCodeRolW, kIKindRolW) \
+	X(DoCodeRolL, kIKindRolL) \
+	X(DoCodeRorB, kIKindRorB) \
+	X(DoCodeRorW, kIKindRorW) \
+	X(DoCodeRorL, kIKindRorL) \
+	X(DoCodeBTstB, kIKindBTstB) \
+	X(DoCodeBChgB, kIKindBChgB) \
+	X(DoCodeBClrB, kIKindBClrB) \
+	X(DoCodeBSetB, kIKindBSetB) \
+	X(DoCodeBTstL, kIKindBTstL) \
+	X(DoCodeBChgL, kIKindBChgL) \
+	X(DoCodeBClrL, kIKindBClrL) \
+	X(DoCodeBSetL, kIKindBSetL) \
+	X(DoCodeAnd, kIKindAndI) \
+	X(DoCodeAnd, kIKindAndEaD) \
+	X(DoCodeAnd, kIKindAndDEa) \
+	X(DoCodeOr, kIKindOrI) \
+	X(DoCodeOr, kIKindOrDEa) \
+	X(DoCodeOr, kIKindOrEaD) \
+	X(DoCodeEor, kIKindEor) \
+	X(DoCodeEor, kIKindEorI) \
+	X(DoCodeNot, kIKindNot) \
+	X(DoCodeScc, kIKindScc) \
+	X(DoCodeNegXB, kIKindNegXB) \
+	X(DoCodeNegXW, kIKindNegXW) \
+	X(DoCodeNegXL, kIKindNegXL) \
+	X(DoCodeNegB, kIKindNegB) \
+	X(DoCodeNegW, kIKindNegW) \
+	X(DoCodeNegL, kIKindNegL) \
+	X(DoCodeEXTW, kIKindEXTW) \
+	X(DoCodeEXTL, kIKindEXTL) \
+	X(DoCodeMulU, kIKindMulU) \
+	X(DoCodeMulS, kIKindMulS) \
+	X(DoCodeDivU, kIKindDivU) \
+	X(DoCodeDivS, kIKindDivS) \
+	X(DoCodeExg, kIKindExg) \
+	X(DoCodeMoveEaCR, kIKindMoveEaCCR) \
+	X(DoCodeMoveSREa, kIKindMoveSREa) \
+	X(DoCodeMoveEaSR, kIKindMoveEaSR) \
+	X(DoCodeOrISR, kIKindOrISR) \
+	X(DoCodeAndISR, kIKindAndISR) \
+	X(DoCodeEorISR, kIKindEorISR) \
+	X(DoCodeOrICCR, kIKindOrICCR) \
+	X(DoCodeAndICCR, kIKindAndICCR) \
+	X(DoCodeEorICCR, kIKindEorICCR) \
+	X(DoCodeMOVEMApRW, kIKindMOVEMApRW) \
+	X(DoCodeMOVEMRmMW, kIKindMOVEMRmMW) \
+	X(DoCodeMOVEMrmW, kIKindMOVEMrmW) \
+	X(DoCodeMOVEMrmL, kIKindMOVEMrmL) \
+	X(DoCodeMOVEMmrW, kIKindMOVEMmrW) \
+	X(DoCodeMOVEMmrL, kIKindMOVEMmrL) \
+	X(DoCodeAbcd, kIKindAbcd) \
+	X(DoCodeSbcd, kIKindSbcd) \
+	X(DoCodeNbcd, kIKindNbcd) \
+	X(DoCodeRte, kIKindRte) \
+	X(DoCodeNop, kIKindNop) \
+	X(DoCodeMoveP0, kIKindMoveP0) \
+	X(DoCodeMoveP1, kIKindMoveP1) \
+	X(DoCodeMoveP2, kIKindMoveP2) \
+	X(DoCodeMoveP3, kIKindMoveP3) \
+	X(op_illg, kIKindIllegal) \
+	X(DoCodeChk, kIKindChkW) \
+	X(DoCodeTrap, kIKindTrap) \
+	X(DoCodeTrapV, kIKindTrapV) \
+	X(DoCodeRtr, kIKindRtr) \
+	X(DoCodeLink, kIKindLink) \
+	X(DoCodeUnlk, kIKindUnlk) \
+	X(DoCodeMoveRUSP, kIKindMoveRUSP) \
+	X(DoCodeMoveUSPR, kIKindMoveUSPR) \
+	X(DoCodeTas, kIKindTas) \
+	X(DoCodeFdefault, kIKindFdflt) \
+	X(DoCodeStop, kIKindStop) \
+	X(DoCodeReset, kIKindReset)
 
 #if Use68020
-	DoCodeCallMorRtm /* kIKindCallMorRtm */,
-	DoCodeBraL /* kIKindBraL */,
-	DoCodeBccL /* kIKindBccL */,
-	DoCodeBsrL /* kIKindBsrL */,
-	DoCodeEXTBL /* kIKindEXTBL */,
-	DoCodeTRAPcc /* kIKindTRAPcc */,
-	DoCodeChk /* kIKindChkL */,
-	DoCodeBkpt /* kIKindBkpt */,
-	DoCodeDivL /* kIKindDivL */,
-	DoCodeMulL /* kIKindMulL */,
-	DoCodeRtd /* kIKindRtd */,
-	DoCodeMoveCCREa /* kIKindMoveCCREa */,
-	DoMoveFromControl /* kIKindMoveCEa */,
-	DoMoveToControl /* kIKindMoveEaC */,
-	DoCodeLinkL /* kIKindLinkL */,
-	DoCodePack /* kIKindPack */,
-	DoCodeUnpk /* kIKindUnpk */,
-	DoCHK2orCMP2 /* kIKindCHK2orCMP2 */,
-	DoCAS2 /* kIKindCAS2 */,
-	DoCAS /* kIKindCAS */,
-	DoMOVES /* kIKindMoveS */,
-	DoBitField /* kIKindBitField */,
+#define OpDispatchList68020(X) \
+	X(DoCodeCallMorRtm, kIKindCallMorRtm) \
+	X(DoCodeBraL, kIKindBraL) \
+	X(DoCodeBccL, kIKindBccL) \
+	X(DoCodeBsrL, kIKindBsrL) \
+	X(DoCodeEXTBL, kIKindEXTBL) \
+	X(DoCodeTRAPcc, kIKindTRAPcc) \
+	X(DoCodeChk, kIKindChkL) \
+	X(DoCodeBkpt, kIKindBkpt) \
+	X(DoCodeDivL, kIKindDivL) \
+	X(DoCodeMulL, kIKindMulL) \
+	X(DoCodeRtd, kIKindRtd) \
+	X(DoCodeMoveCCREa, kIKindMoveCCREa) \
+	X(DoMoveFromControl, kIKindMoveCEa) \
+	X(DoMoveToControl, kIKindMoveEaC) \
+	X(DoCodeLinkL, kIKindLinkL) \
+	X(DoCodePack, kIKindPack) \
+	X(DoCodeUnpk, kIKindUnpk) \
+	X(DoCHK2orCMP2, kIKindCHK2orCMP2) \
+	X(DoCAS2, kIKindCAS2) \
+	X(DoCAS, kIKindCAS) \
+	X(DoMOVES, kIKindMoveS) \
+	X(DoBitField, kIKindBitField)
+#else
+#define OpDispatchList68020(X)
 #endif
+
 #if EmMMU
-	DoCodeMMU /* kIKindMMU */,
+#define OpDispatchListMMU(X) \
+	X(DoCodeMMU, kIKindMMU)
+#else
+#define OpDispatchListMMU(X)
 #endif
+
 #if EmFPU
-	DoCodeFPU_md60 /* kIKindFPUmd60 */,
-	DoCodeFPU_DBcc /* kIKindFPUDBcc */,
-	DoCodeFPU_Trapcc /* kIKindFPUTrapcc */,
-	DoCodeFPU_Scc /* kIKindFPUScc */,
-	DoCodeFPU_FBccW /* kIKindFPUFBccW */,
-	DoCodeFPU_FBccL /* kIKindFPUFBccL */,
-	DoCodeFPU_Save /* kIKindFPUSave */,
-	DoCodeFPU_Restore /* kIKindFPURestore */,
-	DoCodeFPU_dflt /* kIKindFPUdflt */,
+#define OpDispatchListFPU(X) \
+	X(DoCodeFPU_md60, kIKindFPUmd60) \
+	X(DoCodeFPU_DBcc, kIKindFPUDBcc) \
+	X(DoCodeFPU_Trapcc, kIKindFPUTrapcc) \
+	X(DoCodeFPU_Scc, kIKindFPUScc) \
+	X(DoCodeFPU_FBccW, kIKindFPUFBccW) \
+	X(DoCodeFPU_FBccL, kIKindFPUFBccL) \
+	X(DoCodeFPU_Save, kIKindFPUSave) \
+	X(DoCodeFPU_Restore, kIKindFPURestore) \
+	X(DoCodeFPU_dflt, kIKindFPUdflt)
+#else
+#define OpDispatchListFPU(X)
 #endif
 
+#define OpDispatchList(X) \
+	OpDispatchList68000(X) \
+	OpDispatchList68020(X) \
+	OpDispatchListMMU(X) \
+	OpDispatchListFPU(X)
+
+#if ! UseThreadedDispatch
+#define OpDispatchFunc(f, k) f,
+
+LOCALVAR const func_pointer_t OpDispatch[kNumIKinds + 1] = {
+	OpDispatchList(OpDispatchFunc)
 	0
 };
+#endif
 
-LOCALPROC m68k_go_MaxCycles(void)
+LOCALINLINEFUNC DecOpR *m68k_NextDecOp(void)
 {
 	ui5r opcode;
 	DecOpR *p;
-	ui4rr MainClas;
+
+#if USE_PCLIMIT
+	if (my_cond_rare(V_pc_p >= V_pc_pHi)) {
+		Recalc_PC_Block();
+	}
+#endif
+
+#if WantDisasm
+	DisasmOneOrSave(m68k_getpc());
+#endif
+
+#if WantTraceRing
+	{
+		TraceRec *t = &TraceRing[V_regs.TraceIn];
+
+		t->pc = m68k_getpc();
+		t->Cycles = V_MaxCyclesToGo;
+		V_regs.TraceIn = (V_regs.TraceIn + 1) & TraceRing_Mask;
+		opcode = nextiword();
+		t->opcode = opcode;
+	}
+#else
+	opcode = nextiword();
+#endif
+
+	p = &V_regs.disp_table[opcode];
+
+#if WantCloserCyc
+	V_regs.CurDecOp = p;
+#endif
+#if WantDumpTable
+	DumpTable[p->x.MainClas] ++;
+#endif
+
+	return p;
+}
+
+#if UseThreadedDispatch
+
+/*
+	Each instruction kind has its own label, where its handler
+	is called directly, so it can be inlined, followed by its
+	own copy of the fetch and dispatch of the next instruction.
+	The host then predicts each indirect jump from what
+	follows that kind, rather than all from one jump.
+	Needs labels as values, as in GCC and Clang.
+*/
+
+#define OpDispatchLabel(f, k) &&Label_##k,
+
+#define OpDispatchNext() \
+	p = m68k_NextDecOp(); \
+	V_regs.CurDecOpY = p->y; \
+	Last = (((si5rr)(V_MaxCyclesToGo -= p->x.Cycles)) <= 0); \
+	goto *OpLabel[p->x.MainClas];
+
+#define OpDispatchCase(f, k) \
+Label_##k: \
+	f(); \
+	if (Last) { \
+		return; \
+	} \
+	OpDispatchNext()
+
+LOCALPROC m68k_go_MaxCycles(void)
+{
+	static const void * const OpLabel[kNumIKinds] = {
+		OpDispatchList(OpDispatchLabel)
+	};
+	DecOpR *p;
+	blnr Last;
+
+	/*
+		Always execute at least one instruction, as below.
+	*/
+
+	OpDispatchNext()
+
+	OpDispatchList(OpDispatchCase)
+}
+
+#else
+
+LOCALPROC m68k_go_MaxCycles(void)
+{
+	DecOpR *p;
 	ui4rr Cycles;
 	DecOpYR y;
 	func_pointer_t d;
@@ -771,25 +961,10 @@ LOCALPROC m68k_go_MaxCycles(void)
 		d();
 
 label_enter:
-
-#if WantDisasm
-		DisasmOneOrSave(m68k_getpc());
-#endif
-
-		opcode = nextiword();
-
-		p = &V_regs.disp_table[opcode];
-
-#if WantCloserCyc
-		V_regs.CurDecOp = p;
-#endif
-		MainClas = p->x.MainClas;
+		p = m68k_NextDecOp();
 		Cycles = p->x.Cycles;
 		y = p->y;
-#if WantDumpTable
-		DumpTable[MainClas] ++;
-#endif
-		d = OpDispatch[MainClas];
+		d = OpDispatch[p->x.MainClas];
 
 	} while (((si5rr)(V_MaxCyclesToGo -= Cycles)) > 0);
 
@@ -797,6 +972,8 @@ label_enter:
 	d();
 }
 
+#endif
+
 FORWARDFUNC ui5r my_reg_call get_byte_ext(CPTR addr);
 
 LOCALFUNC ui5r my_reg_call get_byte(CPTR addr)
@@ -4040,12 +4217,6 @@ LOCALIPROC DoCodeBccB(void)
 LOCALPROC SkipiWord(void)
 {
 	V_pc_p += 2;
-
-#if USE_PCLIMIT
-	if (my_cond_rare(V_pc_p >= V_pc_pHi)) {
-		Recalc_PC_Block();
-	}
-#endif
 }
 
 #if WantCloserCyc
@@ -4347,6 +4518,140 @@ LOCALPROC my_reg_call m68k_setpc(CPTR newpc)
 	}
 }
 
+/*
+	The trap profiler counts the A-line traps, and charges
+	the cycles from each trap until it returns to the trap,
+	less those of any traps it makes in turn. A trap is taken
+	to have returned when an RTS, RTD, RTR, RTE or JMP goes to
+	where it should come back to, with the stack no deeper
+	than at the trap. Returning to an outer trap also closes
+	any inner ones whose return was missed. Interrupts that
+	come during a trap are charged to it.
+*/
+
+#ifndef WantTrapProfile
+#define WantTrapProfile 0
+#endif
+
+#if WantTrapProfile
+
+#define kTrapProfMaxDepth 64
+
+/* OS traps by the low byte, then Toolbox traps by the low 10 bits */
+#define kTrapProfN 0x0500
+#define TrapProf_Index(t) (((t) & 0x0800) ? (0x0100 + ((t) & 0x03FF)) \
+	: ((t) & 0x00FF))
+#define TrapProf_Trap(i) (((i) < 0x0100) ? (0xA000 + (i)) \
+	: (0xA800 + (i) - 0x0100))
+
+typedef struct {
+	ui5r Calls;
+	ui6b TotalCycles;
+	ui6b SelfCycles;
+	ui6b HostUs;
+} TrapProfStat;
+
+typedef struct {
+	ui5r Index;
+	CPTR ReturnPC;
+	CPTR sp;
+	ui6b StartCycles;
+	ui6b ChildCycles;
+	ui5r StartUs;
+} TrapProfFrame;
+
+LOCALVAR blnr TrapProf_On = falseblnr;
+LOCALVAR int TrapProf_Depth = 0;
+LOCALVAR TrapProfFrame TrapProf_Stack[kTrapProfMaxDepth];
+LOCALVAR TrapProfStat TrapProf_Stats[kTrapProfN];
+
+/*
+	iCountt wraps after a few seconds of scaled cycles, so
+	the time between trap events is added up in TrapProf_Cycles
+*/
+LOCALVAR iCountt TrapProf_LastCount;
+LOCALVAR ui6b TrapProf_Cycles;
+
+#define TrapProf_Now() (NextiCount \
+	- (V_regs.MoreCyclesToGo + V_MaxCyclesToGo))
+
+LOCALPROC TrapProf_Tick(iCountt Now)
+{
+	TrapProf_Cycles += (ui5r)(Now - TrapProf_LastCount);
+	TrapProf_LastCount = Now;
+}
+
+/* pc is at the A-line instruction */
+LOCALPROC TrapProf_Enter(void)
+{
+	TrapProfFrame *f;
+	CPTR pc = m68k_getpc();
+	ui4r t = get_word(pc);
+
+	if (TrapProf_Depth < kTrapProfMaxDepth) {
+		f = &TrapProf_Stack[TrapProf_Depth++];
+		f->Index = TrapProf_Index(t);
+		f->sp = m68k_areg(7);
+		if (0x0C00 == (t & 0x0C00)) {
+			/* auto-pop, returns to the caller of the caller */
+			f->ReturnPC = get_long(f->sp);
+			f->sp += 4;
+		} else {
+			f->ReturnPC = pc + 2;
+		}
+		f->ChildCycles = 0;
+		f->StartUs = GetMicroseconds();
+		TrapProf_Tick(TrapProf_Now());
+		f->StartCycles = TrapProf_Cycles;
+		++TrapProf_Stats[f->Index].Calls;
+	}
+}
+
+LOCALPROC TrapProf_Close(int Depth, iCountt Now)
+{
+	TrapProfFrame *f;
+	TrapProfStat *s;
+	ui6b Cycles;
+	ui5r Us = GetMicroseconds();
+
+	TrapProf_Tick(Now);
+	while (TrapProf_Depth > Depth) {
+		f = &TrapProf_Stack[--TrapProf_Depth];
+		s = &TrapProf_Stats[f->Index];
+		Cycles = TrapProf_Cycles - f->StartCycles;
+		s->TotalCycles += Cycles;
+		s->SelfCycles += Cycles - f->ChildCycles;
+		s->HostUs += Us - f->StartUs;
+		if (TrapProf_Depth > 0) {
+			TrapProf_Stack[TrapProf_Depth - 1].ChildCycles += Cycles;
+		}
+	}
+}
+
+/* call after the stack pointer is updated */
+LOCALPROC TrapProf_Return(CPTR NewPC)
+{
+	int d;
+
+	for (d = TrapProf_Depth; --d >= 0; ) {
+		if ((TrapProf_Stack[d].ReturnPC == NewPC)
+			&& (m68k_areg(7) >= TrapProf_Stack[d].sp))
+		{
+			TrapProf_Close(d, TrapProf_Now());
+			break;
+		}
+	}
+}
+
+#define TrapProf_CheckReturn(NewPC) \
+	if (0 != TrapProf_Depth) { TrapProf_Return(NewPC); }
+
+#else
+
+#define TrapProf_CheckReturn(NewPC)
+
+#endif
+
 LOCALIPROC DoCodeJsr(void)
 {
 	/* Jsr 0100111010mmmrrr */
@@ -4378,6 +4683,7 @@ LOCALIPROC DoCodeRts(void)
 	/* Rts 0100111001110101 */
 	ui5r NewPC = get_long(m68k_areg(7));
 	m68k_areg(7) += 4;
+	TrapProf_CheckReturn(NewPC);
 	m68k_setpc(NewPC);
 }
 
@@ -4386,6 +4692,7 @@ LOCALIPROC DoCodeJmp(void)
 	/* JMP 0100111011mmmrrr */
 	ui5r DstAddr = DecodeDst();
 
+	TrapProf_CheckReturn(DstAddr);
 	m68k_setpc(DstAddr);
 }
 
@@ -4473,6 +4780,7 @@ LOCALPROC NeedToGetOut(void)
 	} else {
 		V_regs.MoreCyclesToGo += V_MaxCyclesToGo;
 			/* not counting the current instruction */
+		TraceRing_AdjCycles(- V_MaxCyclesToGo);
 		V_MaxCyclesToGo = 0;
 	}
 }
@@ -4598,6 +4906,11 @@ LOCALPROC my_reg_call Exception(int nr)
 LOCALIPROC DoCodeA(void)
 {
 	BackupPC();
+#if WantTrapProfile
+	if (TrapProf_On) {
+		TrapProf_Enter();
+	}
+#endif
 	Exception(0xA);
 }
 
@@ -6603,6 +6916,7 @@ LOCALIPROC DoCodeRte(void)
 #endif
 		m68k_areg(7) = stackp;
 		m68k_setSR(NewSR);
+		TrapProf_CheckReturn(NewPC);
 		m68k_setpc(NewPC);
 	}
 }
@@ -6764,6 +7078,7 @@ LOCALIPROC DoCodeRtr(void)
 	stackp += 4;
 	m68k_areg(7) = stackp;
 	m68k_setCR(NewCR);
+	TrapProf_CheckReturn(NewPC);
 	m68k_setpc(NewPC);
 }
 
@@ -6913,12 +7228,6 @@ LOCALIPROC DoCodeBraL(void)
 LOCALPROC SkipiLong(void)
 {
 	V_pc_p += 4;
-
-#if USE_PCLIMIT
-	if (my_cond_rare(V_pc_p >= V_pc_pHi)) {
-		Recalc_PC_Block();
-	}
-#endif
 }
 #endif
 
@@ -7259,7 +7568,20 @@ LOCALFUNC blnr my_reg_call Ui6r_IsNeg(ui6r0 *v)
 }
 #endif
 
-#if Use68020
+/*
+	tools/M68MULDV.c checks MULL and DIVL, and compares
+	these with the portable versions (HaveRealui6b 0).
+*/
+
+#if Use68020 && HaveRealui6b
+LOCALINLINEPROC mul_unsigned(ui5b src1, ui5b src2, ui6r0 *dst)
+{
+	ui6b v = (ui6b)src1 * (ui6b)src2;
+
+	dst->lo = (ui5b)v;
+	dst->hi = (ui5b)(v >> 32);
+}
+#elif Use68020
 LOCALPROC mul_unsigned(ui5b src1, ui5b src2, ui6r0 *dst)
 {
 	ui5b src1_lo = ui5b_lo(src1);
@@ -7279,7 +7601,21 @@ LOCALPROC mul_unsigned(ui5b src1, ui5b src2, ui6r0 *dst)
 }
 #endif
 
-#if Use68020
+#if Use68020 && HaveRealui6b
+LOCALINLINEFUNC blnr div_unsigned(ui6r0 *src, ui5b div,
+	ui5b *quot, ui5b *rem)
+{
+	ui6b v;
+
+	if (div <= src->hi) {
+		return trueblnr;
+	}
+	v = (((ui6b)src->hi) << 32) | src->lo;
+	*quot = (ui5b)(v / div);
+	*rem = (ui5b)(v % div);
+	return falseblnr;
+}
+#elif Use68020
 LOCALFUNC blnr div_unsigned(ui6r0 *src, ui5b div,
 	ui5b *quot, ui5b *rem)
 {
@@ -7325,21 +7661,21 @@ LOCALIPROC DoCodeMulL(void)
 	if (extra & 0x800) {
 		/* MULS.L - signed */
 
-		si5b src1 = (si5b)srcvalue;
-		si5b src2 = (si5b)dstvalue;
-		blnr s1 = src1 < 0;
-		blnr s2 = src2 < 0;
+		ui5b src1 = (ui5b)srcvalue;
+		ui5b src2 = dstvalue;
+		blnr s1 = ((si5b)src1) < 0;
+		blnr s2 = ((si5b)src2) < 0;
 		blnr sr = s1 != s2;
 
 		/* ReportAbnormal("MULS.L"); */
 		/* used by Sys 7.5.5 boot extensions */
 		if (s1) {
-			src1 = - src1;
+			src1 = - src1; /* unsigned, so 0x80000000 is fine */
 		}
 		if (s2) {
 			src2 = - src2;
 		}
-		mul_unsigned((ui5b)src1, (ui5b)src2, &dst);
+		mul_unsigned(src1, src2, &dst);
 		if (sr) {
 			Ui6r_Negate(&dst);
 		}
@@ -7627,6 +7963,7 @@ LOCALIPROC DoCodeRtd(void)
 	/* ReportAbnormal("RTD"); */
 	/* used by Sys 7.5.5 boot */
 	m68k_areg(7) += (4 + offs);
+	TrapProf_CheckReturn(NewPC);
 	m68k_setpc(NewPC);
 }
 #endif
@@ -8221,14 +8558,19 @@ LOCALFUNC ui5b LocalMMDV_Access(ATTep p, ui5b Data,
 {
 	ui5b v;
 
-	Em_Exit();
-	v = MMDV_Access(p, Data, WriteMem, ByteSize, addr);
-	Em_Enter();
+	if (0 != (p->Access & kATTA_mmdvcpufreemask)) {
+		v = p->MMDVproc(p, Data, WriteMem, ByteSize, addr);
+	} else {
+		Em_Exit();
+		v = p->MMDVproc(p, Data, WriteMem, ByteSize, addr);
+		Em_Enter();
+	}
 
 	return v;
 }
 #else
-#define LocalMMDV_Access MMDV_Access
+#define LocalMMDV_Access(p, Data, WriteMem, ByteSize, addr) \
+	(p)->MMDVproc(p, Data, WriteMem, ByteSize, addr)
 #endif
 
 LOCALPROC local_customreset(void)
@@ -8509,6 +8851,44 @@ Label_Retry:
 }
 #endif
 
+#if USE_PCLIMIT
+LOCALPROC Recalc_PC_Stage(CPTR curpc)
+{
+	/*
+		The instruction at curpc could run past the end
+		of its block, so copy what it could be to pcstage,
+		and run it from there. Setting pc_pHi just past the
+		opcode brings the next opcode fetch back here, or
+		to the block once past the end of it.
+	*/
+	ATTep p;
+	CPTR a;
+	ui3p m = (ui3p)V_regs.pcstage;
+	int i;
+
+	for (i = 0; i < kPCGuard; i += 2) {
+		a = curpc + i;
+Label_Retry:
+		p = LocalFindATTel(a);
+		if (0 != (p->Access & kATTA_readreadymask)) {
+			do_put_mem_word(m + i,
+				do_get_mem_word(p->usebase + (a & p->usemask)));
+		} else if ((0 != (p->Access & kATTA_ntfymask))
+			&& LocalMemAccessNtfy(p))
+		{
+			goto Label_Retry;
+		} else {
+			do_put_mem_word(m + i, 0x4AFC);
+		}
+	}
+
+	V_regs.pc_pLo = m;
+	V_pc_p = m;
+	V_pc_pHi = m + 2;
+	V_regs.pc = curpc;
+}
+#endif
+
 LOCALPROC Recalc_PC_Block(void)
 {
 	ATTep p;
@@ -8528,7 +8908,23 @@ Label_Retry:
 			/* happens on Restart */
 #endif
 
+#if USE_PCLIMIT
+		/*
+			the rest of the instruction is fetched with
+			no checks, so it must be in pcstage too
+		*/
+		{
+			ui3p m = (ui3p)V_regs.pcstage;
+			int i;
+
+			for (i = 0; i < kPCGuard; i += 2) {
+				do_put_mem_word(m + i, 0x4AFC);
+			}
+			V_regs.pc_pLo = m;
+		}
+#else
 		V_regs.pc_pLo = V_regs.fakeword;
+#endif
 		V_pc_p = V_regs.pc_pLo;
 		V_pc_pHi = V_regs.pc_pLo + 2;
 		V_regs.pc = curpc;
@@ -8536,41 +8932,24 @@ Label_Retry:
 		ui5r m2 = p->usemask & ~ p->cmpmask;
 		m2 = m2 & ~ (m2 + 1);
 
+#if USE_PCLIMIT
+		if (my_cond_rare(m2 - (curpc & m2) < kPCGuard)) {
+			Recalc_PC_Stage(curpc);
+			return;
+		}
+#endif
+
 		V_pc_p = p->usebase + (curpc & p->usemask);
 		V_regs.pc_pLo = V_pc_p - (curpc & m2);
+#if USE_PCLIMIT
+		V_pc_pHi = V_regs.pc_pLo + m2 + 1 - kPCGuard;
+#else
 		V_pc_pHi = V_regs.pc_pLo + m2 + 1;
+#endif
 		V_regs.pc = curpc - (V_pc_p - V_regs.pc_pLo);
 	}
 }
 
-LOCALFUNC ui5r my_reg_call Recalc_PC_BlockReturnUi5r(ui5r v)
-{
-	/*
-		Used to prevent compiler from saving
-		register on the stack in calling
-		functions, when Recalc_PC_Block isn't being called.
-	*/
-	Recalc_PC_Block();
-
-	return v;
-}
-
-LOCALFUNC ui5r nextilong_ext(void)
-{
-	ui5r r;
-
-	V_pc_p -= 4;
-
-	{
-		ui5r hi = nextiword();
-		ui5r lo = nextiword();
-		r = ((hi << 16) & 0xFFFF0000)
-			| (lo & 0x0000FFFF);
-	}
-
-	return r;
-}
-
 LOCALPROC DoCheckExternalInterruptPending(void)
 {
 	ui3r level = *V_regs.fIPL;
@@ -8593,6 +8972,7 @@ LOCALPROC do_trace(void)
 GLOBALPROC m68k_go_nCycles(ui5b n)
 {
 	Em_Enter();
+	TraceRing_AdjCycles(n + V_regs.ResidualCycles);
 	V_MaxCyclesToGo += (n + V_regs.ResidualCycles);
 	while (V_MaxCyclesToGo > 0) {
 
@@ -8616,11 +8996,13 @@ GLOBALPROC m68k_go_nCycles(ui5b n)
 			do_trace();
 		}
 		m68k_go_MaxCycles();
+		TraceRing_AdjCycles(V_regs.MoreCyclesToGo);
 		V_MaxCyclesToGo += V_regs.MoreCyclesToGo;
 		V_regs.MoreCyclesToGo = 0;
 	}
 
 	V_regs.ResidualCycles = V_MaxCyclesToGo;
+	TraceRing_AdjCycles(- V_MaxCyclesToGo);
 	V_MaxCyclesToGo = 0;
 	Em_Exit();
 }
@@ -8642,6 +9024,7 @@ GLOBALPROC SetCyclesRemaining(si5r n)
 
 	if (V_MaxCyclesToGo >= n) {
 		V_regs.MoreCyclesToGo = 0;
+		TraceRing_AdjCycles(n - V_MaxCyclesToGo);
 		V_MaxCyclesToGo = n;
 	} else {
 		V_regs.MoreCyclesToGo = n - V_MaxCyclesToGo;
@@ -8736,12 +9119,40 @@ GLOBALPROC SetHeadATTel(ATTep p)
 	/* force Recalc_PC_Block soon */
 		V_regs.pc = m68k_getpc();
 		V_regs.pc_pLo = V_pc_p;
+#if USE_PCLIMIT
+		/*
+			at the next opcode fetch, since the rest of
+			the instruction is fetched with no checks
+		*/
+		V_pc_pHi = V_regs.pc_pLo;
+#else
 		V_pc_pHi = V_regs.pc_pLo + 2;
+#endif
 	V_regs.HeadATTel = p;
 
 	Em_Exit();
 }
 
+/*
+	Call after taking away write access from ATT elements,
+	so that cached translations for writes aren't used.
+*/
+GLOBALPROC m68k_ATTAccessChngNtfy(void)
+{
+	Em_Enter();
+
+	V_regs.MATCwrB.cmpmask = 0;
+	V_regs.MATCwrB.cmpvalu = 0xFFFFFFFF;
+	V_regs.MATCwrW.cmpmask = 0;
+	V_regs.MATCwrW.cmpvalu = 0xFFFFFFFF;
+#if FasterAlignedL
+	V_regs.MATCwrL.cmpmask = 0;
+	V_regs.MATCwrL.cmpvalu = 0xFFFFFFFF;
+#endif
+
+	Em_Exit();
+}
+
 GLOBALPROC DiskInsertedPsuedoException(CPTR newpc, ui5b data)
 {
 	Em_Enter();
@@ -8849,6 +9260,183 @@ GLOBALPROC m68k_reset(void)
 	Em_Exit();
 }
 
+#if WantTraceRing
+
+/*
+	trace file, all big endian: a header of kTraceFileHeaderSz
+	bytes, which is 8 longs (magic, number of records,
+	kCycleScale, RAM size, ROM size, ROM base, flags, 0), then
+	the records oldest first as 3 longs each (pc, cycles,
+	opcode, see TraceRec), then RAM, then ROM.
+*/
+
+#define kTraceFileMagic 0x4D363854 /* 'M68T' */
+#define kTraceFileHeaderSz 32
+#define kTraceFileRecSz 12
+#define kTraceFileFlag68020 1
+
+#define TraceRing_ChunkN 256
+
+GLOBALPROC m68k_TraceRingDump(void)
+{
+	ui3b b[TraceRing_ChunkN * kTraceFileRecSz];
+	ui3p p = b;
+	TraceRec *t;
+	ui5r i;
+	ui5r j = regs.TraceIn;
+
+	if (TraceFile_Open("m68trace.bin")) {
+		do_put_mem_long(p, kTraceFileMagic);
+		do_put_mem_long(p + 4, TraceRing_N);
+		do_put_mem_long(p + 8, kCycleScale);
+		do_put_mem_long(p + 12, RAM_Size);
+		do_put_mem_long(p + 16, kROM_Size);
+		do_put_mem_long(p + 20, kROM_Base);
+		do_put_mem_long(p + 24, Use68020 ? kTraceFileFlag68020 : 0);
+		do_put_mem_long(p + 28, 0);
+		TraceFile_Write(b, kTraceFileHeaderSz);
+
+		for (i = 0; i < TraceRing_N; ++i) {
+			t = &TraceRing[j];
+			do_put_mem_long(p, t->pc);
+			do_put_mem_long(p + 4, t->Cycles);
+			do_put_mem_long(p + 8, t->opcode);
+			p += kTraceFileRecSz;
+			if (p == b + sizeof(b)) {
+				TraceFile_Write(b, sizeof(b));
+				p = b;
+			}
+			j = (j + 1) & TraceRing_Mask;
+		}
+		if (p != b) {
+			TraceFile_Write(b, p - b);
+		}
+
+		TraceFile_Write(RAM, RAM_Size);
+		TraceFile_Write(ROM, kROM_Size);
+		TraceFile_Close();
+	}
+}
+#endif
+
+#if WantTrapProfile
+LOCALFUNC ui3p TrapProf_PutStr(ui3p p, char *s)
+{
+	while (0 != *s) {
+		*p++ = *s++;
+	}
+	return p;
+}
+
+/* right aligned in Width columns */
+LOCALFUNC ui3p TrapProf_PutNum(ui3p p, ui6b v, int Width)
+{
+	ui3b d[20];
+	int n = 0;
+
+	do {
+		d[n++] = '0' + (v % 10);
+		v /= 10;
+	} while (0 != v);
+	while (Width-- > n) {
+		*p++ = ' ';
+	}
+	while (n > 0) {
+		*p++ = d[--n];
+	}
+	return p;
+}
+
+LOCALFUNC ui3p TrapProf_PutHex4(ui3p p, ui4r v)
+{
+	int i;
+
+	for (i = 12; i >= 0; i -= 4) {
+		*p++ = "0123456789ABCDEF"[(v >> i) & 0x0F];
+	}
+	return p;
+}
+
+/*
+	text file, one line per trap that was called, most self
+	cycles first. Cycles are 68000 clocks, host microseconds
+	are inclusive.
+*/
+LOCALPROC TrapProf_Report(void)
+{
+	ui4b Order[kTrapProfN];
+	ui3b b[128];
+	ui3p p;
+	TrapProfStat *s;
+	int n = 0;
+	int i;
+	int j;
+	ui4b k;
+
+	for (i = 0; i < kTrapProfN; ++i) {
+		if (0 != TrapProf_Stats[i].Calls) {
+			/* insertion sort, there are not many */
+			for (j = n++; (j > 0) && (TrapProf_Stats[Order[j - 1]]
+				.SelfCycles < TrapProf_Stats[i].SelfCycles); --j)
+			{
+				Order[j] = Order[j - 1];
+			}
+			Order[j] = i;
+		}
+	}
+
+	if (TraceFile_Open("trapprof.txt")) {
+		p = TrapProf_PutStr(b, "cycles ");
+		p = TrapProf_PutNum(p, TrapProf_Cycles / kCycleScale, 0);
+		p = TrapProf_PutStr(p,
+			"\ntrap      calls          total           self"
+			"        host us\n");
+		TraceFile_Write(b, p - b);
+		for (i = 0; i < n; ++i) {
+			k = Order[i];
+			s = &TrapProf_Stats[k];
+			p = TrapProf_PutHex4(b, TrapProf_Trap(k));
+			p = TrapProf_PutNum(p, s->Calls, 11);
+			p = TrapProf_PutNum(p, s->TotalCycles / kCycleScale, 15);
+			p = TrapProf_PutNum(p, s->SelfCycles / kCycleScale, 15);
+			p = TrapProf_PutNum(p, s->HostUs, 15);
+			*p++ = '\n';
+			TraceFile_Write(b, p - b);
+		}
+		TraceFile_Close();
+	}
+}
+#endif
+
+#if WantTrapProfile
+/*
+	start counting from zero, or stop and save the report,
+	charging any traps still open up to now
+*/
+GLOBALPROC m68k_TrapProfToggle(void)
+{
+	int i;
+	iCountt Now = GetCuriCount();
+
+	if (TrapProf_On) {
+		TrapProf_Close(0, Now);
+		TrapProf_On = falseblnr;
+		TrapProf_Report();
+	} else {
+		for (i = 0; i < kTrapProfN; ++i) {
+			TrapProf_Stats[i].Calls = 0;
+			TrapProf_Stats[i].TotalCycles = 0;
+			TrapProf_Stats[i].SelfCycles = 0;
+			TrapProf_Stats[i].HostUs = 0;
+		}
+		TrapProf_Depth = 0;
+		TrapProf_LastCount = Now;
+		TrapProf_Cycles = 0;
+		TrapProf_On = trueblnr;
+	}
+}
+#endif
+
 #if SmallGlobals
 GLOBALPROC MINEM68K_ReserveAlloc(void)
 {
@@ -35,6 +35,13 @@ EXPORTPROC SetCyclesRemaining(si5r n);
 
 EXPORTPROC m68k_go_nCycles(ui5b n);
 
+#if WantTraceRing
+EXPORTPROC m68k_TraceRingDump(void);
+#endif
+#if WantTrapProfile
+EXPORTPROC m68k_TrapProfToggle(void);
+#endif
+
 /*
 	general purpose access of address space
 	of emulated computer. (memory and
@@ -50,4 +57,5 @@ EXPORTPROC put_vm_word(CPTR addr, ui4r w);
 EXPORTPROC put_vm_long(CPTR addr, ui5r l);
 
 EXPORTPROC SetHeadATTel(ATTep p);
+EXPORTPROC m68k_ATTAccessChngNtfy(void);
 EXPORTFUNC ATTep FindATTel(CPTR addr);
@@ -198,6 +198,14 @@ EXPORTVAR(blnr, EmVideoDisable)
 EXPORTVAR(si3b, EmLagTime)
 
 EXPORTOSGLUPROC Screen_OutputFrame(ui3p screencurrentbuff);
+
+#ifndef ScreenWriteTracked
+#define ScreenWriteTracked 0
+#endif
+
+#if ScreenWriteTracked
+EXPORTOSGLUPROC Screen_NoteWritten(ui5r Start, ui5r End);
+#endif
 EXPORTOSGLUPROC DoneWithDrawingForTick(void);
 
 EXPORTVAR(blnr, ForceMacOff)
@@ -206,6 +214,25 @@ EXPORTVAR(blnr, WantMacInterrupt)
 
 EXPORTVAR(blnr, WantMacReset)
 
+EXPORTVAR(ui5r, RAMSizeRequest)
+	/* bytes of RAM wanted, 0 for the most the build allows */
+
+#if WantTraceRing
+EXPORTVAR(blnr, WantTraceRingDump)
+#endif
+
+#if WantTrapProfile
+EXPORTVAR(blnr, WantTrapProfToggle)
+
+EXPORTOSGLUFUNC ui5r GetMicroseconds(void);
+#endif
+
+#if WantTraceRing || WantTrapProfile
+EXPORTOSGLUFUNC blnr TraceFile_Open(char *Name);
+EXPORTOSGLUPROC TraceFile_Write(ui3p p, ui5r L);
+EXPORTOSGLUPROC TraceFile_Close(void);
+#endif
+
 EXPORTOSGLUFUNC blnr ExtraTimeNotOver(void);
 
 EXPORTVAR(ui3b, SpeedValue)
@@ -231,6 +258,31 @@ EXPORTVAR(ui5r, QuietSubTicks)
 #define QuietEnds()
 #endif
 
+#if EnableAutoTurbo
+EXPORTVAR(blnr, AutoTurboActive)
+EXPORTVAR(blnr, AutoTurboBooting)
+EXPORTVAR(ui5r, AutoTurboDiskQuiet)
+EXPORTVAR(ui5r, AutoTurboInputQuiet)
+
+/* counters, for tuning */
+EXPORTVAR(ui5r, AutoTurboTicks)
+EXPORTVAR(ui5r, AutoTurboSpurts)
+
+#define AutoTurboDiskNotify() \
+{ \
+	AutoTurboDiskQuiet = 0; \
+}
+
+#define AutoTurboInputNotify() \
+{ \
+	AutoTurboBooting = falseblnr; \
+	AutoTurboInputQuiet = 0; \
+}
+#else
+#define AutoTurboDiskNotify()
+#define AutoTurboInputNotify()
+#endif
+
 #if 3 == kLn2SoundSampSz
 #define trSoundSamp ui3r
 #define tbSoundSamp ui3b
@@ -66,8 +66,113 @@
 	ReportAbnormalID unused 0x1002 - 0x10FF
 */
 
+#if EnableAutoTurbo
+
+/*
+	Auto turbo runs the emulation as fast as it will go, with
+	the screen drawn only now and then (and the glue muting
+	sound), while the disk driver is busy, and from reset until
+	booting looks finished, that is until the disk has been
+	quiet for a while. Any input from the user ends it, and
+	keeps it off for a bit, so that the user gets the speed
+	they asked for while doing something.
+
+	The quiet counts are in sub ticks of emulated time, so that
+	they mean the same thing with or without turbo.
+*/
+
+#ifndef kAutoTurboDiskIdleTicks
+#define kAutoTurboDiskIdleTicks 30
+#endif
+
+#ifndef kAutoTurboBootIdleTicks
+#define kAutoTurboBootIdleTicks 180
+#endif
+
+#ifndef kAutoTurboInputHoldTicks
+#define kAutoTurboInputHoldTicks 60
+#endif
+
+#ifndef kAutoTurboDrawEvery /* power of two */
+#define kAutoTurboDrawEvery 8
+#endif
+
+#define dbglog_AutoTurbo (0 && dbglog_HAVE)
+
+LOCALVAR ui5r AutoTurboSpurtTicks = 0;
+
+LOCALPROC AutoTurbo_Reset(void)
+{
+	AutoTurboBooting = trueblnr;
+	AutoTurboDiskQuiet = 0;
+}
+
+LOCALPROC AutoTurbo_AddSubTicks(ui5r n)
+{
+	ui5r v;
+
+	v = AutoTurboDiskQuiet + n;
+	if (v > AutoTurboDiskQuiet) {
+		/* if not overflow */
+		AutoTurboDiskQuiet = v;
+	}
+
+	v = AutoTurboInputQuiet + n;
+	if (v > AutoTurboInputQuiet) {
+		/* if not overflow */
+		AutoTurboInputQuiet = v;
+	}
+}
+
+LOCALFUNC blnr AutoTurbo_Wanted(void)
+{
+	if (AutoTurboInputQuiet < kAutoTurboInputHoldTicks * kNumSubTicks) {
+		return falseblnr;
+	}
+
+	if (AutoTurboBooting) {
+		if (AutoTurboDiskQuiet < kAutoTurboBootIdleTicks * kNumSubTicks) {
+			return trueblnr;
+		}
+		AutoTurboBooting = falseblnr;
+	}
+
+	return AutoTurboDiskQuiet < kAutoTurboDiskIdleTicks * kNumSubTicks;
+}
+
+LOCALPROC AutoTurbo_Set(blnr v)
+{
+	if (v != AutoTurboActive) {
+		AutoTurboActive = v;
+		if (v) {
+			++AutoTurboSpurts;
+			AutoTurboSpurtTicks = 0;
+		} else {
+#if dbglog_AutoTurbo
+			dbglog_writelnNum("AutoTurbo spurt ticks",
+				AutoTurboSpurtTicks);
+#endif
+		}
+	}
+}
+
+/* once per tick */
+LOCALPROC AutoTurbo_Update(void)
+{
+	AutoTurbo_Set(AutoTurbo_Wanted());
+	if (AutoTurboActive) {
+		++AutoTurboTicks;
+		++AutoTurboSpurtTicks;
+	}
+}
+
+#endif /* EnableAutoTurbo */
+
 LOCALPROC EmulatedHardwareZap(void)
 {
+#if EnableAutoTurbo
+	AutoTurbo_Reset();
+#endif
 	Memory_Reset();
 	ICT_Zap();
 	IWM_Reset();
@@ -104,6 +209,18 @@ LOCALPROC InterruptReset_Update(void)
 		DoMacReset();
 		WantMacReset = falseblnr;
 	}
+#if WantTraceRing
+	if (WantTraceRingDump) {
+		m68k_TraceRingDump();
+		WantTraceRingDump = falseblnr;
+	}
+#endif
+#if WantTrapProfile
+	if (WantTrapProfToggle) {
+		m68k_TrapProfToggle();
+		WantTrapProfToggle = falseblnr;
+	}
+#endif
 }
 
 LOCALPROC SubTickNotify(int SubTick)
@@ -221,8 +338,9 @@ LOCALPROC ExtraTimeEndNotify(void)
 
 GLOBALPROC EmulationReserveAlloc(void)
 {
+	RAM_ChooseSize();
 	ReserveAllocOneBlock(&RAM,
-		kRAM_Size + RAMSafetyMarginFudge, 5, falseblnr);
+		RAM_Size + RAMSafetyMarginFudge, 5, falseblnr);
 #if EmVidCard
 	ReserveAllocOneBlock(&VidROM, kVidROM_Size, 5, falseblnr);
 #endif
@@ -326,6 +444,15 @@ LOCALPROC ICT_DoCurrentTasks(void)
 		++i;
 		m >>= 1;
 	}
+
+	if (0 != ICTheapN) {
+		while ((i = ICT_TakeDueEvent()) >= 0) {
+#ifdef _VIA_Debug
+			fprintf(stderr, "doing event %d, %d\n", NextiCount, i);
+#endif
+			ICT_DoEvent(i);
+		}
+	}
 }
 
 LOCALFUNC ui5b ICT_DoGetNext(ui5b maxn)
@@ -355,6 +482,10 @@ LOCALFUNC ui5b ICT_DoGetNext(ui5b maxn)
 		m >>= 1;
 	}
 
+	if (0 != ICTheapN) {
+		v = ICT_EventTimeToNext(v);
+	}
+
 	return v;
 }
 
@@ -405,6 +536,9 @@ LOCALPROC DoEmulateOneTick(void)
 		}
 	}
 #endif
+#if EnableAutoTurbo
+	AutoTurbo_AddSubTicks(kNumSubTicks);
+#endif
 
 	SixtiethSecondNotify();
 
@@ -412,7 +546,16 @@ LOCALPROC DoEmulateOneTick(void)
 
 	SixtiethEndNotify();
 
-	if ((ui3b) -1 == SpeedValue) {
+#if EnableAutoTurbo
+	AutoTurbo_Update();
+#endif
+
+	if (((ui3b) -1 == SpeedValue)
+#if EnableAutoTurbo
+		|| AutoTurboActive
+#endif
+		)
+	{
 		ExtraSubTicksToDo = (ui5b) -1;
 	} else {
 		ui5b ExtraAdd = (kNumSubTicks << SpeedValue) - kNumSubTicks;
@@ -429,6 +572,16 @@ LOCALFUNC blnr MoreSubTicksToDo(void)
 {
 	blnr v = falseblnr;
 
+#if EnableAutoTurbo
+	if (AutoTurboActive && ! AutoTurbo_Wanted()) {
+		/* back to the chosen speed, without waiting for the tick */
+		AutoTurbo_Set(falseblnr);
+		if ((ui3b) -1 != SpeedValue) {
+			ExtraSubTicksToDo = 0;
+		}
+	}
+#endif
+
 	if (ExtraTimeNotOver() && (ExtraSubTicksToDo > 0)) {
 #if EnableAutoSlow
 		if ((QuietSubTicks >= 16384)
@@ -470,6 +623,9 @@ LOCALPROC DoEmulateExtraTime(void)
 					QuietSubTicks = NewQuietSubTicks;
 				}
 			}
+#endif
+#if EnableAutoTurbo
+			AutoTurbo_AddSubTicks(1);
 #endif
 			m68k_go_nCycles_1(CyclesScaledPerSubTick);
 			--ExtraSubTicksToDo;
@@ -513,7 +669,16 @@ LOCALPROC RunEmulatedTicksToTrueTime(void)
 		DoEmulateOneTick();
 		++CurEmulatedTime;
 
-		DoneWithDrawingForTick();
+#if EnableAutoTurbo
+		if (AutoTurboActive
+			&& (0 != (CurEmulatedTime & (kAutoTurboDrawEvery - 1))))
+		{
+			/* leave the changes for a later tick */
+		} else
+#endif
+		{
+			DoneWithDrawingForTick();
+		}
 
 		if (n > 8) {
 			/* emulation not fast enough */
@@ -0,0 +1,231 @@
+/*
+	SCRNCNVT.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	SCReeN CoNVerT
+
+	Table driven conversion of rows of the emulated screen,
+	packed 1, 2, 4 or 8 bits per pixel, into the pixel format
+	of the host texture. Kept apart from the glue so that
+	tools/SCRNCBEN.c can time these same kernels on the host.
+*/
+
+/* required arguments for this template */
+
+#ifndef FBPIXEL /* fbpixel from 8 bit red, green, blue */
+#error "FBPIXEL not defined"
+#endif
+
+	/*
+		also the types fbpixel, one texture pixel, and
+		fbpixel2, two of them, must be declared.
+	*/
+
+/* optional argument for this template */
+
+#ifndef ScrnCnvt_Depth /* log2 bits per pixel of the color tables */
+#define ScrnCnvt_Depth vMacScreenDepth
+#endif
+
+fbpixel Table1BPP[ 256 ][ 8 ];
+
+#if ScrnCnvt_Depth == 1
+fbpixel Table2BPP[ 256 ][ 4 ];
+#elif ScrnCnvt_Depth == 2
+fbpixel2 Table4BPP[ 256 ];
+#elif ScrnCnvt_Depth == 3
+fbpixel Table8BPP[ 256 ];
+#endif
+
+/*
+ * Converts a 1bpp packed image and outputs it in the texture format.
+ * The ARM11 has no NEON, so the copy is spelled out to let the
+ * compiler use ldm/stm instead of calling memcpy. The row is read
+ * whole before any of it is stored, since Dest could otherwise
+ * alias the table and force a load and a store per pixel.
+ */
+void Convert1BPP( u8* Src, fbpixel* Dest, int Size ) {
+	const fbpixel* Row = NULL;
+	fbpixel p0, p1, p2, p3, p4, p5, p6, p7;
+	
+	do {
+		Row = Table1BPP[ *Src++ ];
+		
+		p0 = Row[ 0 ]; p1 = Row[ 1 ]; p2 = Row[ 2 ]; p3 = Row[ 3 ];
+		p4 = Row[ 4 ]; p5 = Row[ 5 ]; p6 = Row[ 6 ]; p7 = Row[ 7 ];
+		
+		Dest[ 0 ] = p0;
+		Dest[ 1 ] = p1;
+		Dest[ 2 ] = p2;
+		Dest[ 3 ] = p3;
+		Dest[ 4 ] = p4;
+		Dest[ 5 ] = p5;
+		Dest[ 6 ] = p6;
+		Dest[ 7 ] = p7;
+		
+		Dest+= 8;
+		Size-= 8;
+	}
+	while ( Size > 0 );
+}
+
+/*
+ * Sets up the 1BPP->texture format conversion table.
+ */
+LOCALPROC MakeTable1BPP( void ) {
+	const fbpixel White = FBPIXEL( 0xFF, 0xFF, 0xFF );
+	int i = 0;
+	
+	for ( i = 0; i < 256; i++ ) {
+		Table1BPP[ i ][ 0 ] = ( i & BIT( 7 ) ) ? 0 : White;
+		Table1BPP[ i ][ 1 ] = ( i & BIT( 6 ) ) ? 0 : White;
+		Table1BPP[ i ][ 2 ] = ( i & BIT( 5 ) ) ? 0 : White;
+		Table1BPP[ i ][ 3 ] = ( i & BIT( 4 ) ) ? 0 : White;
+		Table1BPP[ i ][ 4 ] = ( i & BIT( 3 ) ) ? 0 : White;
+		Table1BPP[ i ][ 5 ] = ( i & BIT( 2 ) ) ? 0 : White;
+		Table1BPP[ i ][ 6 ] = ( i & BIT( 1 ) ) ? 0 : White;
+		Table1BPP[ i ][ 7 ] = ( i & BIT( 0 ) ) ? 0 : White;	
+	}	
+}
+
+#if ScrnCnvt_Depth == 3
+/*
+ * Sets up the 8bpp->16bpp paletted to texture format conversion table.
+ */
+void MakeTable8BPP( u16* Reds, u16* Greens, u16* Blues ) {
+    int i = 0;
+    
+    for ( i = 0; i < 256; i++ ) {
+		Table8BPP[ i ] = FBPIXEL( Reds[ i ] >> 8, Greens[ i ] >> 8, Blues[ i ] >> 8 );
+    }
+}
+
+/*
+ * Converts an 8bpp paletted image and outputs it in the texture format.
+ * Four pixels per pass, reading the source a word at a time.
+ */
+static void Convert8BPP( u8* Src, fbpixel* Dest, int Size ) {
+	u32 Quad = 0;
+	
+	if ( ( ( uintptr_t ) Src & 3 ) == 0 ) {
+		while ( Size >= 4 ) {
+			Quad = *( u32* ) Src;
+			
+			/* Little endian, so the leftmost pixel is the low byte */
+			Dest[ 0 ] = Table8BPP[ Quad & 0xFF ];
+			Dest[ 1 ] = Table8BPP[ ( Quad >> 8 ) & 0xFF ];
+			Dest[ 2 ] = Table8BPP[ ( Quad >> 16 ) & 0xFF ];
+			Dest[ 3 ] = Table8BPP[ Quad >> 24 ];
+			
+			Src+= 4;
+			Dest+= 4;
+			Size-= 4;
+		}
+	}
+	
+    while ( Size-- > 0 ) {
+        *Dest++ = Table8BPP[ *Src++ ];
+    }
+}
+#endif
+
+#if ScrnCnvt_Depth == 1
+/*
+ * Sets up the 2bpp->16bpp paletted to texture format conversion table.
+ */
+void MakeTable2BPP( u16* Reds, u16* Greens, u16* Blues ) {
+	int i, j, c = 0;
+	
+	for ( i = 0; i < 256; i++ ) {
+		for ( j = 0; j < 4; j++ ) {
+			c = ( i >> ( 6 - ( j * 2 ) ) ) & 0x03;
+			Table2BPP[ i ][ j ] = FBPIXEL( Reds[ c ] >> 8, Greens[ c ] >> 8, Blues[ c ] >> 8 );
+		}
+	}
+}
+
+/*
+ * Converts a 2bpp packed image and outputs it in the texture format.
+ */
+static void Convert2BPP( u8* Src, fbpixel* Dest, int Size ) {
+	const fbpixel* Row = NULL;
+	fbpixel p0, p1, p2, p3;
+	
+	do {
+		Row = Table2BPP[ *Src++ ];
+		
+		/* As for Convert1BPP, the row is read before it is stored */
+		p0 = Row[ 0 ]; p1 = Row[ 1 ]; p2 = Row[ 2 ]; p3 = Row[ 3 ];
+		
+		Dest[ 0 ] = p0;
+		Dest[ 1 ] = p1;
+		Dest[ 2 ] = p2;
+		Dest[ 3 ] = p3;
+		
+		Dest+= 4;
+		Size-= 4;
+	}
+	while ( Size > 0 );
+}
+#endif
+
+#if ScrnCnvt_Depth == 2
+/*
+ * Sets up the 4bpp->16bpp paletted to texture format conversion table.
+ */
+void MakeTable4BPP( u16* Reds, u16* Greens, u16* Blues ) {
+	int r, g, b, l, h, i = 0;
+	fbpixel* Ptr = NULL;
+	
+	for ( i = 0; i < 256; i++ ) {
+		l = i >> 4;
+		h = i & 0x0F;
+		
+		Ptr = ( fbpixel* ) &Table4BPP[ i ];
+		
+		r = ( Reds[ h ] >> 8 ) & 0xFF;
+		g = ( Greens[ h ] >> 8 ) & 0xFF;
+		b = ( Blues[ h ] >> 8 ) & 0xFF;
+		
+		Ptr[ 1 ] = FBPIXEL( r, g, b );
+		
+		r = ( Reds[ l ] >> 8 ) & 0xFF;
+		g = ( Greens[ l ] >> 8 ) & 0xFF;
+		b = ( Blues[ l ] >> 8 ) & 0xFF;
+		
+		Ptr[ 0 ] = FBPIXEL( r, g, b );
+	}
+}
+
+/*
+ * Converts an 4bpp packed image and outputs it in the texture format.
+ */
+static void Convert4BPP( u8* Src, fbpixel2* Dest, int Size ) {
+	while ( Size >= 8 ) {
+		Dest[ 0 ] = Table4BPP[ Src[ 0 ] ];
+		Dest[ 1 ] = Table4BPP[ Src[ 1 ] ];
+		Dest[ 2 ] = Table4BPP[ Src[ 2 ] ];
+		Dest[ 3 ] = Table4BPP[ Src[ 3 ] ];
+		
+		Src+= 4;
+		Dest+= 4;
+		Size-= 8;
+	}
+	
+	while ( Size > 0 ) {
+		*Dest++ = Table4BPP[ *Src++ ];
+		Size-= 2;
+	}
+}
+#endif
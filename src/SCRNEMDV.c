@@ -37,8 +37,8 @@
 #if ! IncludeVidMem
 #define kMain_Offset      0x5900
 #define kAlternate_Offset 0xD900
-#define kMain_Buffer      (kRAM_Size - kMain_Offset)
-#define kAlternate_Buffer (kRAM_Size - kAlternate_Offset)
+#define kMain_Buffer      (RAM_Size - kMain_Offset)
+#define kAlternate_Buffer (RAM_Size - kAlternate_Offset)
 #endif
 
 GLOBALPROC Screen_EndTickNotify(void)
@@ -47,6 +47,16 @@ GLOBALPROC Screen_EndTickNotify(void)
 
 #if IncludeVidMem
 	screencurrentbuff = VidMem;
+#if ScreenWriteTracked
+	{
+		ui5r Start;
+		ui5r End;
+
+		if (VidMemTrack_TakeDirty(&Start, &End)) {
+			Screen_NoteWritten(Start, End);
+		}
+	}
+#endif
 #else
 	if (SCRNvPage2 == 1) {
 		screencurrentbuff = get_ram_address(kMain_Buffer);
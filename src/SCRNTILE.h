@@ -0,0 +1,129 @@
+/*
+	SCRNTILE.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	SCReeN TILE dirty tracking
+
+	Keeps track of which parts of a staging buffer, that the
+	screen is converted into before it is copied to the host
+	video hardware, have changed since the last copy. The
+	buffer is split into bands of kScrnTileRows full width
+	rows, since that is the smallest piece a tiled texture
+	transfer can be done in, and one bit is kept per band.
+
+	ScrnTile_TakeSpans hands back runs of dirty bands, as row
+	ranges, and forgets them. Nothing here knows about the host
+	video calls, the glue does the flushing and transferring,
+	and tools/SCRNTCHK.c checks it on the host.
+*/
+
+/* required argument for this template */
+
+#ifndef ScrnTile_Height /* rows in the staging buffer */
+#error "ScrnTile_Height not defined"
+#endif
+
+/* optional arguments for this template */
+
+#ifndef kScrnTileShift /* log2 of rows per band */
+#define kScrnTileShift 3
+#endif
+
+#ifndef kScrnTileMaxSpans /* most spans returned at once */
+#define kScrnTileMaxSpans 4
+#endif
+
+#ifndef kScrnTileMergeGap
+	/*
+		clean bands between two dirty runs that are copied
+		anyway rather than starting another span
+	*/
+#define kScrnTileMergeGap 1
+#endif
+
+#define kScrnTileRows (1 << kScrnTileShift)
+#define kScrnTileNBands \
+	((ScrnTile_Height + kScrnTileRows - 1) >> kScrnTileShift)
+#define kScrnTileNWords ((kScrnTileNBands + 31) >> 5)
+
+typedef struct {
+	ui4r Top;
+	ui4r Bottom; /* exclusive, always a multiple of kScrnTileRows */
+} ScrnTileSpan;
+
+LOCALVAR ui5b ScrnTileDirty[kScrnTileNWords];
+
+#define ScrnTile_IsDirty(i) \
+	(0 != (ScrnTileDirty[(i) >> 5] & ((ui5b)1 << ((i) & 31))))
+
+/* mark the rows from Top up to (but not including) Bottom */
+LOCALPROC ScrnTile_NoteRows(si4r Top, si4r Bottom)
+{
+	si4r i;
+
+	if (Top < 0) {
+		Top = 0;
+	}
+	if (Bottom > ScrnTile_Height) {
+		Bottom = ScrnTile_Height;
+	}
+	if (Top < Bottom) {
+		for (i = Top >> kScrnTileShift;
+			i <= ((Bottom - 1) >> kScrnTileShift); ++i)
+		{
+			ScrnTileDirty[i >> 5] |= ((ui5b)1 << (i & 31));
+		}
+	}
+}
+
+LOCALPROC ScrnTile_NoteAll(void)
+{
+	ScrnTile_NoteRows(0, ScrnTile_Height);
+}
+
+/*
+	Fill in Spans with runs of dirty bands, top to bottom, and
+	clear them. Runs closer together than kScrnTileMergeGap are
+	joined, and once MaxSpans is reached the last span is
+	stretched to cover whatever is left, so that the caller
+	never needs more than MaxSpans transfers. Returns the
+	number of spans.
+*/
+LOCALFUNC int ScrnTile_TakeSpans(ScrnTileSpan *Spans, int MaxSpans)
+{
+	int i;
+	int n = 0;
+	int LastDirty = - (kScrnTileMergeGap + 2);
+
+	for (i = 0; i < kScrnTileNBands; ++i) {
+		if (ScrnTile_IsDirty(i)) {
+			if ((n > 0) && ((i - LastDirty - 1 <= kScrnTileMergeGap)
+				|| (n == MaxSpans)))
+			{
+				/* extend the current span */
+			} else {
+				Spans[n].Top = i << kScrnTileShift;
+				++n;
+			}
+			Spans[n - 1].Bottom = (i + 1) << kScrnTileShift;
+			LastDirty = i;
+		}
+	}
+
+	for (i = 0; i < kScrnTileNWords; ++i) {
+		ScrnTileDirty[i] = 0;
+	}
+
+	return n;
+}
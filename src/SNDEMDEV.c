@@ -39,8 +39,8 @@
 #define kSnd_Main_Offset   0x0300
 #define kSnd_Alt_Offset    0x5F00
 
-#define kSnd_Main_Buffer (kRAM_Size - kSnd_Main_Offset)
-#define kSnd_Alt_Buffer (kRAM_Size - kSnd_Alt_Offset)
+#define kSnd_Main_Buffer (RAM_Size - kSnd_Main_Offset)
+#define kSnd_Alt_Buffer (RAM_Size - kSnd_Alt_Offset)
 
 /*
 	approximate volume levels of vMac, so:
@@ -104,11 +104,120 @@ LOCALVAR ui4b SoundInvertState = 0;
 
 IMPORTFUNC ui4b GetSoundInvertTime(void);
 
+#ifndef ln2mtb
+typedef ui3p SndBuffAddr;
+#define SndBuffByte(a, i) ((a)[i])
+#else
+typedef CPTR SndBuffAddr;
+#define SndBuffByte(a, i) get_vm_byte((a) + (i))
+#endif
+
+#if 4 == kLn2SoundSampSz
+#define SndSampFromByte(x) ((trSoundSamp)(x) << 8)
+#else
+#define SndSampFromByte(x) ((trSoundSamp)(x))
+#endif
+
+#define SndScaleSamp(x, mult, offset) \
+	((trSoundSamp)((ui5b)(x) * (mult) >> 16) + (offset))
+
+/*
+	The sound buffer has one sample in the high byte of each
+	word. These copy a block of them, four at a time, the
+	second one applying the volume on the way.
+*/
+
+LOCALPROC MacSound_Gather(tpSoundSamp p, SndBuffAddr addr, ui4r n)
+{
+	for (; n >= 4; n -= 4) {
+		p[0] = SndSampFromByte(SndBuffByte(addr, 0));
+		p[1] = SndSampFromByte(SndBuffByte(addr, 2));
+		p[2] = SndSampFromByte(SndBuffByte(addr, 4));
+		p[3] = SndSampFromByte(SndBuffByte(addr, 6));
+		p += 4;
+		addr += 8;
+	}
+	for (; n > 0; --n) {
+		*p++ = SndSampFromByte(SndBuffByte(addr, 0));
+		addr += 2;
+	}
+}
+
+LOCALPROC MacSound_GatherScaled(tpSoundSamp p, SndBuffAddr addr,
+	ui4r n, ui5b mult, trSoundSamp offset)
+{
+	for (; n >= 4; n -= 4) {
+		p[0] = SndScaleSamp(SndSampFromByte(SndBuffByte(addr, 0)),
+			mult, offset);
+		p[1] = SndScaleSamp(SndSampFromByte(SndBuffByte(addr, 2)),
+			mult, offset);
+		p[2] = SndScaleSamp(SndSampFromByte(SndBuffByte(addr, 4)),
+			mult, offset);
+		p[3] = SndScaleSamp(SndSampFromByte(SndBuffByte(addr, 6)),
+			mult, offset);
+		p += 4;
+		addr += 8;
+	}
+	for (; n > 0; --n) {
+		*p++ = SndScaleSamp(SndSampFromByte(SndBuffByte(addr, 0)),
+			mult, offset);
+		addr += 2;
+	}
+}
+
+LOCALPROC MacSound_Fill(tpSoundSamp p, ui4r n, trSoundSamp v)
+{
+	for (; n > 0; --n) {
+		*p++ = v;
+	}
+}
+
+LOCALPROC MacSound_Scale(tpSoundSamp p, ui4r n,
+	ui5b mult, trSoundSamp offset)
+{
+	for (; n > 0; --n) {
+		*p = SndScaleSamp(*p, mult, offset);
+		++p;
+	}
+}
+
+/*
+	Mix in the square wave from VIA timer 1 on PB7, as the
+	fraction of each sample period that the output is on.
+*/
+LOCALPROC MacSound_Invert(tpSoundSamp p, ui4r n, ui5b PhaseIncr)
+{
+	for (; n > 0; --n) {
+		if (SoundInvertPhase < 704) {
+			ui5b OnPortion = 0;
+			ui5b LastPhase = 0;
+			do {
+				if (! SoundInvertState) {
+					OnPortion +=
+						(SoundInvertPhase - LastPhase);
+				}
+				SoundInvertState = ! SoundInvertState;
+				LastPhase = SoundInvertPhase;
+				SoundInvertPhase += PhaseIncr;
+			} while (SoundInvertPhase < 704);
+			if (! SoundInvertState) {
+				OnPortion += 704 - LastPhase;
+			}
+			*p = (*p * OnPortion) / 704;
+		} else {
+			if (SoundInvertState) {
+				*p = 0;
+			}
+		}
+		SoundInvertPhase -= 704;
+		p++;
+	}
+}
+
 GLOBALPROC MacSound_SubTick(int SubTick)
 {
 	ui4r actL;
 	tpSoundSamp p;
-	ui4r i;
 	ui5b StartOffset = SubTick_offset[SubTick];
 	ui4r n = SubTick_n[SubTick];
 	unsigned long addy =
@@ -117,14 +226,16 @@ GLOBALPROC MacSound_SubTick(int SubTick)
 #endif
 		kSnd_Main_Buffer;
 #ifndef ln2mtb
-	ui3p addr = addy + (2 * StartOffset) + RAM;
+	SndBuffAddr addr = addy + (2 * StartOffset) + RAM;
 #else
-	CPTR addr = addy + (2 * StartOffset);
+	SndBuffAddr addr = addy + (2 * StartOffset);
 #endif
 	ui4b SoundInvertTime = GetSoundInvertTime();
 	ui3b SoundVolume = SoundVolb0
 		| (SoundVolb1 << 1)
 		| (SoundVolb2 << 2);
+	ui5b mult = (SoundVolume < 7) ? (ui5b)vol_mult[SoundVolume] : 0;
+	trSoundSamp offset = vol_offset[SoundVolume];
 
 #if dbglog_HAVE && 0
 	dbglog_StartLine();
@@ -135,80 +246,40 @@ GLOBALPROC MacSound_SubTick(int SubTick)
 	dbglog_writeReturn();
 #endif
 
+	/*
+		Usually have volume at 7, so the scaling is
+		just for completeness.
+	*/
+
 label_retry:
 	p = MySound_BeginWrite(n, &actL);
 	if (actL > 0) {
 		if (SoundDisable && (SoundInvertTime == 0)) {
-			for (i = 0; i < actL; i++) {
-#if 0
-				*p++ = 0x00; /* this is believed more accurate */
-#else
-				/* But this avoids more clicks. */
-				*p++ = kCenterSound;
-#endif
-			}
-		} else {
-			for (i = 0; i < actL; i++) {
-				/* Copy sound data, high byte of each word */
-				*p++ =
-#ifndef ln2mtb
-					*addr
-#else
-					get_vm_byte(addr)
-#endif
-#if 4 == kLn2SoundSampSz
-					<< 8
-#endif
-					;
-
-				/* Move the address on */
-				addr += 2;
-			}
-
-			if (SoundInvertTime != 0) {
-				ui5b PhaseIncr = (ui5b)SoundInvertTime * (ui5b)20;
-				p -= actL;
-
-				for (i = 0; i < actL; i++) {
-					if (SoundInvertPhase < 704) {
-						ui5b OnPortion = 0;
-						ui5b LastPhase = 0;
-						do {
-							if (! SoundInvertState) {
-								OnPortion +=
-									(SoundInvertPhase - LastPhase);
-							}
-							SoundInvertState = ! SoundInvertState;
-							LastPhase = SoundInvertPhase;
-							SoundInvertPhase += PhaseIncr;
-						} while (SoundInvertPhase < 704);
-						if (! SoundInvertState) {
-							OnPortion += 704 - LastPhase;
-						}
-						*p = (*p * OnPortion) / 704;
-					} else {
-						if (SoundInvertState) {
-							*p = 0;
-						}
-					}
-					SoundInvertPhase -= 704;
-					p++;
-				}
-			}
-		}
-
-		if (SoundVolume < 7) {
 			/*
-				Usually have volume at 7, so this
-				is just for completeness.
+				Silent, so every sample is the same, and
+				only needs scaling once. 0x00 is believed
+				more accurate, but this avoids more clicks.
 			*/
-			ui5b mult = (ui5b)vol_mult[SoundVolume];
-			trSoundSamp offset = vol_offset[SoundVolume];
+			trSoundSamp v = kCenterSound;
 
-			p -= actL;
-			for (i = 0; i < actL; i++) {
-				*p = (trSoundSamp)((ui5b)(*p) * mult >> 16) + offset;
-				++p;
+			if (SoundVolume < 7) {
+				v = SndScaleSamp(v, mult, offset);
+			}
+			MacSound_Fill(p, actL, v);
+		} else if (SoundInvertTime == 0) {
+			if (SoundVolume < 7) {
+				MacSound_GatherScaled(p, addr, actL, mult, offset);
+			} else {
+				MacSound_Gather(p, addr, actL);
+			}
+			addr += 2 * actL;
+		} else {
+			MacSound_Gather(p, addr, actL);
+			addr += 2 * actL;
+			MacSound_Invert(p, actL,
+				(ui5b)SoundInvertTime * (ui5b)20);
+			if (SoundVolume < 7) {
+				MacSound_Scale(p, actL, mult, offset);
 			}
 		}
 
@@ -83,6 +83,85 @@ LOCALFUNC tMacErr CheckReadableDrive(tDrive Drive_No)
 	return result;
 }
 
+#define DC42ChecksumsTracked (Sony_SupportDC42 \
+	&& (Sony_WantChecksumsUpdated || Sony_VerifyChecksums))
+
+#if DC42ChecksumsTracked
+/*
+	The Disk Copy 4.2 checksums can't just be patched up
+	for the blocks written, because carries out of the add
+	feed into the rotate. Instead the running checksum at
+	the start of each of up to kDC42MaxSegs segments of an
+	area is saved. A write only throws away the sums from
+	its segment on, and Sony_Update brings them back up to
+	date one segment per tick. So by the time a disk is
+	ejected there is usually nothing left to compute.
+	Nothing is summed for an image that is never written,
+	except with Sony_VerifyChecksums, which sums the whole
+	image once to check it against the header.
+*/
+
+#define kDC42MaxSegs 128
+
+struct DC42ChkR {
+	ui5r Start; /* offset of area in disk image file */
+	ui5r Size;
+	ui5r SegSize;
+	ui5r NumSegs;
+	ui5r NumValid; /* Sums[0] to Sums[NumValid] are good */
+	ui5b Sums[kDC42MaxSegs + 1];
+		/* checksum of area up to start of each segment */
+};
+typedef struct DC42ChkR DC42ChkR;
+
+#if Sony_SupportTags
+#define kDC42NumAreas 2 /* data, then tags */
+#else
+#define kDC42NumAreas 1
+#endif
+
+LOCALVAR DC42ChkR DC42Chk[NumDrives][kDC42NumAreas];
+LOCALVAR ui5b DC42ChkMask = 0;
+	/* drives with DC42Chk set up */
+LOCALVAR ui5b DC42ChkWrittenMask = 0;
+	/* drives written to since mounted */
+#if Sony_VerifyChecksums
+LOCALVAR ui5b DC42ChkVerifyMask = 0;
+LOCALVAR ui5r DC42ChkExpect[NumDrives][kDC42NumAreas];
+#endif
+
+LOCALPROC DC42ChkNoteWrite(tDrive Drive_No,
+	ui5r Sony_Start, ui5r Sony_Count)
+{
+	int j;
+	DC42ChkR *c;
+	ui5r seg;
+
+	if (0 != (DC42ChkMask & ((ui5b)1 << Drive_No))) {
+		DC42ChkWrittenMask |= ((ui5b)1 << Drive_No);
+#if Sony_VerifyChecksums
+		/*
+			the checksums in the header are of the image as
+			mounted, so no longer anything to compare with
+		*/
+		DC42ChkVerifyMask &= ~ ((ui5b)1 << Drive_No);
+#endif
+		for (j = 0; j < kDC42NumAreas; ++j) {
+			c = &DC42Chk[Drive_No][j];
+			if ((Sony_Start < c->Start + c->Size)
+				&& (Sony_Start + Sony_Count > c->Start))
+			{
+				seg = (Sony_Start <= c->Start) ? 0
+					: (Sony_Start - c->Start) / c->SegSize;
+				if (seg < c->NumValid) {
+					c->NumValid = seg;
+				}
+			}
+		}
+	}
+}
+#endif
+
 LOCALFUNC tMacErr vSonyTransferVM(blnr IsWrite,
 	CPTR Buffera, tDrive Drive_No,
 	ui5r Sony_Start, ui5r Sony_Count, ui5r *Sony_ActCount)
@@ -99,6 +178,12 @@ LOCALFUNC tMacErr vSonyTransferVM(blnr IsWrite,
 	ui5r offset = Sony_Start;
 	ui5r n = Sony_Count;
 
+#if DC42ChecksumsTracked
+	if (IsWrite) {
+		DC42ChkNoteWrite(Drive_No, Sony_Start, Sony_Count);
+	}
+#endif
+
 label_1:
 	if (0 == n) {
 		result = mnvm_noErr;
@@ -175,7 +260,10 @@ LOCALVAR ui5r ImageTagOffset[NumDrives];
 
 #define ChecksumBlockSize 1024
 
-#if Sony_SupportDC42 && Sony_WantChecksumsUpdated
+#if DC42ChecksumsTracked
+/*
+	continue the checksum in *r over Sony_Count more bytes
+*/
 LOCALFUNC tMacErr DC42BlockChecksum(tDrive Drive_No,
 	ui5r Sony_Start, ui5r Sony_Count, ui5r *r)
 {
@@ -183,7 +271,7 @@ LOCALFUNC tMacErr DC42BlockChecksum(tDrive Drive_No,
 	ui5r n;
 	ui3b Buffer[ChecksumBlockSize];
 	ui3b *p;
-	ui5b sum = 0;
+	ui5b sum = *r;
 	ui5r offset = Sony_Start;
 	ui5r remaining = Sony_Count;
 
@@ -221,6 +309,126 @@ LOCALFUNC tMacErr DC42BlockChecksum(tDrive Drive_No,
 }
 #endif
 
+#if DC42ChecksumsTracked
+LOCALPROC DC42ChkSetup(DC42ChkR *c, ui5r Start, ui5r Size)
+{
+	ui5r SegSize = (Size + kDC42MaxSegs - 1) / kDC42MaxSegs;
+
+	/* whole number of checksum blocks, so always even */
+	SegSize = (SegSize + ChecksumBlockSize - 1)
+		& ~ (ui5r)(ChecksumBlockSize - 1);
+	if (0 == SegSize) {
+		SegSize = ChecksumBlockSize;
+	}
+
+	c->Start = Start;
+	c->Size = Size;
+	c->SegSize = SegSize;
+	c->NumSegs = (Size + SegSize - 1) / SegSize;
+	c->NumValid = 0;
+	c->Sums[0] = 0;
+}
+#endif
+
+#if DC42ChecksumsTracked
+/*
+	checksum the first segment not yet done,
+	returns false if nothing was left to do
+*/
+LOCALFUNC blnr DC42ChkStep(tDrive Drive_No, DC42ChkR *c)
+{
+	ui5r i = c->NumValid;
+	ui5r offset;
+	ui5r n;
+	ui5r sum;
+
+	if (i >= c->NumSegs) {
+		return falseblnr;
+	}
+
+	offset = i * c->SegSize;
+	n = c->Size - offset;
+	if (n > c->SegSize) {
+		n = c->SegSize;
+	}
+	sum = c->Sums[i];
+	if (mnvm_noErr != DC42BlockChecksum(Drive_No,
+		c->Start + offset, n, &sum))
+	{
+		ReportAbnormalID(0x0902, "Failed to find DC42 checksum");
+		sum = 0;
+	}
+	c->Sums[i + 1] = sum;
+	c->NumValid = i + 1;
+
+	return trueblnr;
+}
+#endif
+
+#if DC42ChecksumsTracked
+LOCALFUNC ui5r DC42ChkFinish(tDrive Drive_No, DC42ChkR *c)
+{
+	while (DC42ChkStep(Drive_No, c)) {
+	}
+
+	return c->Sums[c->NumSegs];
+}
+#endif
+
+#if DC42ChecksumsTracked && Sony_VerifyChecksums
+LOCALPROC DC42ChkVerify(tDrive Drive_No)
+{
+	if (DC42ChkFinish(Drive_No, &DC42Chk[Drive_No][0])
+		!= DC42ChkExpect[Drive_No][0])
+	{
+		ReportAbnormalID(0x0904, "bad dataChecksum");
+	}
+#if Sony_SupportTags
+	if (DC42ChkFinish(Drive_No, &DC42Chk[Drive_No][1])
+		!= DC42ChkExpect[Drive_No][1])
+	{
+		ReportAbnormalID(0x0905, "bad tagChecksum");
+	}
+#endif
+	DC42ChkVerifyMask &= ~ ((ui5b)1 << Drive_No);
+}
+#endif
+
+#if DC42ChecksumsTracked
+/*
+	Called once a tick, does at most one segment
+	of checksumming, for the first drive needing it,
+	which is one written to since mounted, or one
+	still to be verified.
+*/
+LOCALPROC DC42ChkUpdate(void)
+{
+	tDrive i;
+	int j;
+	ui5b Busy = DC42ChkWrittenMask;
+
+#if Sony_VerifyChecksums
+	Busy |= DC42ChkVerifyMask;
+#endif
+	if (0 != Busy) {
+		for (i = 0; i < NumDrives; ++i) {
+			if (0 != (Busy & ((ui5b)1 << i))) {
+				for (j = 0; j < kDC42NumAreas; ++j) {
+					if (DC42ChkStep(i, &DC42Chk[i][j])) {
+						return;
+					}
+				}
+#if Sony_VerifyChecksums
+				if (0 != (DC42ChkVerifyMask & ((ui5b)1 << i))) {
+					DC42ChkVerify(i);
+				}
+#endif
+			}
+		}
+	}
+}
+#endif
+
 #if Sony_SupportDC42 && Sony_WantChecksumsUpdated
 #if Sony_SupportTags
 #define SizeCheckSumsToUpdate 8
@@ -232,57 +440,41 @@ LOCALFUNC tMacErr DC42BlockChecksum(tDrive Drive_No,
 #if Sony_WantChecksumsUpdated
 LOCALPROC Drive_UpdateChecksums(tDrive Drive_No)
 {
-	if (! vSonyIsLocked(Drive_No)) {
-		ui5r DataOffset = ImageDataOffset[Drive_No];
 #if Sony_SupportDC42
-		if (kDC42offset_userData == DataOffset) {
-			/* a disk copy 4.2 image */
-			tMacErr result;
-			ui5r dataChecksum;
+	if (0 != (DC42ChkMask & ((ui5b)1 << Drive_No))) {
+		if (0 != (DC42ChkWrittenMask & ((ui5b)1 << Drive_No))) {
+			/*
+				a disk copy 4.2 image that has been written to,
+				only checksums of segments written since the
+				last update are left to do
+			*/
 			ui3b Buffer[SizeCheckSumsToUpdate];
 			ui5r Sony_Count = SizeCheckSumsToUpdate;
-			ui5r DataSize = ImageDataSize[Drive_No];
 
-			/* Checksum image data */
-			result = DC42BlockChecksum(Drive_No,
-				DataOffset, DataSize, &dataChecksum);
-			if (mnvm_noErr != result) {
-				ReportAbnormalID(0x0902, "Failed to find dataChecksum");
-				dataChecksum = 0;
-			}
-			do_put_mem_long(Buffer, dataChecksum);
+			do_put_mem_long(Buffer,
+				DC42ChkFinish(Drive_No, &DC42Chk[Drive_No][0]));
 #if Sony_SupportTags
-			{
-				ui5r tagChecksum;
-				ui5r TagOffset = ImageTagOffset[Drive_No];
-				ui5r TagSize =
-					(0 == TagOffset) ? 0 : ((DataSize >> 9) * 12);
-				if (TagSize < 12) {
-					tagChecksum = 0;
-				} else {
-					/*
-						Checksum of tags doesn't include first block.
-						presumably because of bug in original disk
-						copy program.
-					*/
-					result = DC42BlockChecksum(Drive_No,
-						TagOffset + 12, TagSize - 12, &tagChecksum);
-					if (mnvm_noErr != result) {
-						ReportAbnormalID(0x0903,
-							"Failed to find tagChecksum");
-						tagChecksum = 0;
-					}
-				}
-				do_put_mem_long(Buffer + 4, tagChecksum);
-			}
+			do_put_mem_long(Buffer + 4,
+				DC42ChkFinish(Drive_No, &DC42Chk[Drive_No][1]));
 #endif
 
 			/* write Checksums */
 			vSonyTransfer(trueblnr, Buffer, Drive_No,
 				kDC42offset_dataChecksum, Sony_Count, nullpr);
 		}
-#endif
 	}
+#endif
+}
+#endif
+
+#if DC42ChecksumsTracked
+LOCALPROC DC42ChkStop(tDrive Drive_No)
+{
+	DC42ChkMask &= ~ ((ui5b)1 << Drive_No);
+	DC42ChkWrittenMask &= ~ ((ui5b)1 << Drive_No);
+#if Sony_VerifyChecksums
+	DC42ChkVerifyMask &= ~ ((ui5b)1 << Drive_No);
+#endif
 }
 #endif
 
@@ -353,32 +545,6 @@ LOCALFUNC tMacErr vSonyNextPendingInsert(tDrive *Drive_No)
 								gotFormat = trueblnr;
 							}
 							if (gotFormat) {
-#if Sony_VerifyChecksums /* mostly useful to check the Checksum code */
-								ui5r dataChecksum;
-								ui5r tagChecksum;
-								ui5r dataChecksum0 = do_get_mem_long(
-									&Temp[kDC42offset_dataChecksum]);
-								ui5r tagChecksum0 = do_get_mem_long(
-									&Temp[kDC42offset_tagChecksum]);
-								result = DC42BlockChecksum(i,
-									DataOffset0, DataSize0,
-									&dataChecksum);
-								if (TagSize0 >= 12) {
-									result = DC42BlockChecksum(i,
-										TagOffset0 + 12, TagSize0 - 12,
-										&tagChecksum);
-								} else {
-									tagChecksum = 0;
-								}
-								if (dataChecksum != dataChecksum0) {
-									ReportAbnormalID(0x0904,
-										"bad dataChecksum");
-								}
-								if (tagChecksum != tagChecksum0) {
-									ReportAbnormalID(0x0905,
-										"bad tagChecksum");
-								}
-#endif
 								DataOffset = DataOffset0;
 								DataSize = DataSize0;
 #if Sony_SupportTags
@@ -386,6 +552,42 @@ LOCALFUNC tMacErr vSonyNextPendingInsert(tDrive *Drive_No)
 									(0 == TagSize0) ? 0 : TagOffset0;
 #endif
 
+#if DC42ChecksumsTracked
+								/*
+									checksums get computed bit by bit
+									in Sony_Update from here on.
+								*/
+								DC42ChkSetup(&DC42Chk[i][0],
+									DataOffset0, DataSize0);
+#if Sony_SupportTags
+								/*
+									Checksum of tags doesn't include
+									first block. presumably because
+									of bug in original disk copy
+									program.
+								*/
+								DC42ChkSetup(&DC42Chk[i][1],
+									TagOffset0 + 12,
+									(TagSize0 >= 12)
+										? TagSize0 - 12 : 0);
+#endif
+#if Sony_VerifyChecksums
+								/* mostly useful to check the Checksum code */
+								DC42ChkExpect[i][0] = do_get_mem_long(
+									&Temp[kDC42offset_dataChecksum]);
+#if Sony_SupportTags
+								DC42ChkExpect[i][1] = do_get_mem_long(
+									&Temp[kDC42offset_tagChecksum]);
+#endif
+								DC42ChkVerifyMask |= ((ui5b)1 << i);
+#else
+								if (! vSonyIsLocked(i))
+#endif
+								{
+									DC42ChkMask |= ((ui5b)1 << i);
+								}
+#endif
+
 #if (! Sony_SupportTags) || (! Sony_WantChecksumsUpdated)
 								if (! vSonyIsLocked(i)) {
 #if ! Sony_WantChecksumsUpdated
@@ -439,6 +641,10 @@ LOCALVAR CPTR MountCallBack = 0;
 /* This checks to see if a disk (image) has been inserted */
 GLOBALPROC Sony_Update (void)
 {
+#if DC42ChecksumsTracked
+	DC42ChkUpdate();
+#endif
+
 	if (DelayUntilNextInsert != 0) {
 		--DelayUntilNextInsert;
 	} else {
@@ -476,6 +682,7 @@ LOCALFUNC tMacErr Drive_Transfer(blnr IsWrite, CPTR Buffera,
 	tMacErr result;
 
 	QuietEnds();
+	AutoTurboDiskNotify();
 
 	if (nullpr != Sony_ActCount) {
 		*Sony_ActCount = 0;
@@ -526,6 +733,9 @@ LOCALFUNC tMacErr Drive_Eject(tDrive Drive_No)
 		vSonyMountedMask &= ~ ((ui5b)1 << Drive_No);
 #if Sony_WantChecksumsUpdated
 		Drive_UpdateChecksums(Drive_No);
+#endif
+#if DC42ChecksumsTracked
+		DC42ChkStop(Drive_No);
 #endif
 		result = vSonyEject(Drive_No);
 		if (QuitOnEject != 0) {
@@ -549,6 +759,9 @@ LOCALFUNC tMacErr Drive_EjectDelete(tDrive Drive_No)
 			result = mnvm_vLckdErr;
 		} else {
 			vSonyMountedMask &= ~ ((ui5b)1 << Drive_No);
+#if DC42ChecksumsTracked
+			DC42ChkStop(Drive_No);
+#endif
 			result = vSonyEjectDelete(Drive_No);
 		}
 	}
@@ -566,6 +779,9 @@ GLOBALPROC Sony_EjectAllDisks(void)
 		if (vSonyIsInserted(i)) {
 #if Sony_WantChecksumsUpdated
 			Drive_UpdateChecksums(i);
+#endif
+#if DC42ChecksumsTracked
+			DC42ChkStop(i);
 #endif
 			(void) vSonyEject(i);
 		}
@@ -95,6 +95,9 @@
 #define kStrCmdReset "Herstart"
 #define kStrCmdInterrupt "Onderbreek"
 #define kStrCmdHelp "Hulp (toon deze pagina)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Huidige snelheid: ^s"
@@ -117,6 +120,10 @@
 
 #define kStrNewCntrlKey "Ge;uemuleerde ;]control;} toets ^k."
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "annuleer"
 
 #define kStrConfirmReset "Bent u er zeker van dat u de ge;uemuleerde computer wilt herstarten?  Werk dat niet bewaard werd zal verloren gaan, en er bestaat een kans dat het gebruikte schijfkopiebestand beschadigd geraakt. Typ een letter:"
@@ -95,6 +95,9 @@
 #define kStrCmdReset "Reset"
 #define kStrCmdInterrupt "Interrupt"
 #define kStrCmdHelp "Help (show this page)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Current speed: ^s"
@@ -117,6 +120,10 @@
 
 #define kStrNewCntrlKey "Emulated ;]control;} key ^k."
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "cancel"
 
 #define kStrConfirmReset "Are you sure you want to reset the emulated computer? Unsaved changes will be lost, and there is a risk of corrupting the mounted disk image files. Type a letter:"
@@ -96,6 +96,9 @@
 #define kStrCmdReset "R;eeinitialisation"
 #define kStrCmdInterrupt "Interruption"
 #define kStrCmdHelp "Aide (affiche cette page)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Vitesse courante : ^s"
@@ -118,6 +121,10 @@
 
 #define kStrNewCntrlKey "Touche Contr;iole virtuelle ^k."
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "Annuler"
 
 #define kStrConfirmReset "Souhaitez-vous vraiment r;eeinitialiser l;}ordinateur virtuel ? Vous allez perdre les modifications non enregistr;eees et vous risquez d;}endommager les images disques ouvertes."
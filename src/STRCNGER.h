@@ -95,6 +95,9 @@
 #define kStrCmdReset "Neustarten (Reset durchf;uuhren)"
 #define kStrCmdInterrupt "Interrupt"
 #define kStrCmdHelp "Hilfe (zeigt diese Befehlsliste)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Momentane Geschwindigkeit: ^s"
@@ -117,6 +120,10 @@
 
 #define kStrNewCntrlKey "Emulierte ;]Control;}-Taste ^k"
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "Abbrechen"
 
 #define kStrConfirmReset "Wollen Sie den emulierten Rechner wirklich neustarten? Ungesicherte ;uAnderungen werden verlorengehen und gemountete Disketten-Images k;uonnen besch;uadigt werden. Dr;uucken Sie einen dieser Buchstaben:"
@@ -98,6 +98,9 @@
 #define kStrCmdReset "Reset"
 #define kStrCmdInterrupt "Interrupt"
 #define kStrCmdHelp "Aiuto (mostra questo messaggio)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Velocit;`a attuale: ^s"
@@ -120,6 +123,10 @@
 
 #define kStrNewCntrlKey "Il tasto ;]control;} emulato ;`e ^k"
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "Annulla"
 
 #define kStrConfirmReset "Sei sicuro di voler resettare la macchina emulata? Le modifiche non salvate andranno perse e le immagini disco montate potrebbero venire danneggiate. Premi una lettera:"
@@ -95,6 +95,9 @@
 #define kStrCmdReset "Reset"
 #define kStrCmdInterrupt "Przerwanie"
 #define kStrCmdHelp "Pomoc (ta strona)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Obecna pr;dedko;es;ec: ^s"
@@ -117,6 +120,10 @@
 
 #define kStrNewCntrlKey "Emulowany klawiszem Control jest ^k."
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "anuluj"
 
 #define kStrConfirmReset "Czy na pewno chcesz zresetowa;ec emulator? Zmiany nie zostan;da zapisane, istnieje ryzyko uszkodzenia obraz;eow dysk;eow. Podaj liter;de:"
@@ -125,6 +125,9 @@
 #define kStrCmdInterrupt "Interromper"
 
 #define kStrCmdHelp "Ajuda (mostrar esta p;eagina)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Velocidade atual: ^s"
@@ -155,6 +158,10 @@
 
 #define kStrNewCntrlKey "Emula;c;nao da tecla ;]control;} ^k."
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "cancelar"
 
 #define kStrConfirmReset "Tem certeza de que deseja reiniciar o computador emulado? As altera;c;noes n;nao salvas ser;nao perdidas e h;ea o risco de corromper os arquivos de imagem de disco montados. Digite uma letra:"
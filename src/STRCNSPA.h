@@ -95,6 +95,9 @@
 #define kStrCmdReset "Reset"
 #define kStrCmdInterrupt "Interrumpir"
 #define kStrCmdHelp "Ayuda (mostrar esta p;eagina)"
+#define kStrCmdOvlDskEject "Disk overlay on eject: keep, commit, discard"
+#define kStrCmdTraceDump "Save instruction trace"
+#define kStrCmdTrapProfile "Start or stop trap profile"
 
 /* Speed Control Screen */
 #define kStrCurrentSpeed "Velocidad actual: ^s"
@@ -117,6 +120,10 @@
 
 #define kStrNewCntrlKey "Emulado tecla ;]control;} ^k."
 
+#define kStrNewOvlDskKeep "Disk overlays are kept on eject."
+#define kStrNewOvlDskCommit "Disk overlays are committed on eject."
+#define kStrNewOvlDskDiscard "Disk overlays are discarded on eject."
+
 #define kStrCmdCancel "cancelar"
 
 #define kStrConfirmReset "Est;ea seguro de desear reiniciar el ordenador emulado? Los cambios no salvados se perderan, y existe riesgo de corrupci;eon en las im;eagenes de discos montadas. Pulse una tecla:"
@@ -534,6 +534,10 @@ LOCALPROC FillScreenWithGrayPattern(void)
 			pat = ~ pat;
 		}
 	}
+
+#if ScreenWriteTracked
+	VidMemTrack_AllDirty();
+#endif
 }
 
 GLOBALPROC ExtnVideo_Access(CPTR p)
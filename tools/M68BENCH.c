@@ -0,0 +1,518 @@
+/*
+	M68BENCH.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	host tool to time the CPU emulation (src/MINEM68K.c) on
+	small 68k loops, with no ROM and no rest of the machine,
+	so a change to the CPU core can be measured by itself.
+
+	build with the configuration of a variant, for example:
+		cc -m32 -O2 -DHaveGlbReg=0 -o m68bench \
+			-Ivariants/MacII8bpp/cfg -Isrc \
+			tools/M68BENCH.c src/MINEM68K.c src/M68KITAB.c
+	The configurations take long to be 32 bits, as it is on
+	the 3DS, hence -m32 on a 64 bit host. HaveGlbReg can be
+	left alone when the host is an ARM that the global
+	registers of EMCONFIG.h suit.
+
+	m68bench [-r reps] [-c Mcycles] [kernel ...]
+		run each kernel (default all) for Mcycles (default 16)
+		million emulated cycles, reps (default 5) times, and
+		print one line per kernel, for the best of the runs:
+
+		kernel,insns,cycles,ns_per_insn,ns_per_cycle
+
+	Each kernel is an inner loop, of iters passes through the
+	body and a DBRA, inside an outer loop that counts its
+	passes in memory. The number of instructions run is worked
+	out from that count, so the emulated cycle budget can end
+	anywhere in the loop. Emulated cycles per instruction,
+	cycles / insns, is a check on the cycle counting, and
+	should not change when only speed was meant to.
+*/
+
+#include "SYSDEPNS.h"
+
+#include "ENDIANAC.h"
+#include "MYOSGLUE.h"
+#include "EMCONFIG.h"
+#include "GLOBGLUE.h"
+#include "M68KITAB.h"
+#include "MINEM68K.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kRAMsz 0x00100000
+#define kCodeAddr 0x1000
+#define kStackAddr 0x8000
+#define kCountAddr 0x3000 /* outer passes, set by the kernel */
+#define kSrcAddr 0x10000
+#define kDstAddr 0x20000
+
+#define kDefaultReps 5
+#define kDefaultMcycles 16
+#define kMaxMcycles 32 /* so the scaled budget fits in 32 bits */
+
+typedef char ui5bIs32Bits[(4 == sizeof(ui5b)) ? 1 : -1];
+
+/* what the CPU emulation needs from the rest of the emulator */
+
+GLOBALVAR ui5r RAMa_Size = kRAMa_Size;
+GLOBALVAR ui5r RAMb_Size = kRAMb_Size;
+GLOBALVAR iCountt NextiCount = 0;
+
+GLOBALFUNC iCountt GetCuriCount(void)
+{
+	return NextiCount - GetCyclesRemaining();
+}
+
+#if dbglog_HAVE
+GLOBALPROC DoReportAbnormalID(ui4r id, char *s)
+{
+	fprintf(stderr, "m68bench: abnormal %04X %s\n", id, s);
+}
+#else
+GLOBALPROC DoReportAbnormalID(ui4r id)
+{
+	fprintf(stderr, "m68bench: abnormal %04X\n", id);
+}
+#endif
+
+GLOBALFUNC blnr MemAccessNtfy(ATTep pT)
+{
+	UnusedParam(pT);
+	return falseblnr;
+}
+
+GLOBALPROC customreset(void)
+{
+}
+
+#if WantTraceRing || WantTrapProfile
+GLOBALOSGLUFUNC blnr TraceFile_Open(char *Name)
+{
+	UnusedParam(Name);
+	return falseblnr;
+}
+
+GLOBALOSGLUPROC TraceFile_Write(ui3p p, ui5r L)
+{
+	UnusedParam(p);
+	UnusedParam(L);
+}
+
+GLOBALOSGLUPROC TraceFile_Close(void)
+{
+}
+#endif
+
+#if WantTrapProfile
+GLOBALOSGLUFUNC ui5r GetMicroseconds(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+/*
+	The kernels, hand assembled. Setup runs once, Outer at
+	the start of each pass of the outer loop, then Body
+	runs Iters times. BodyInsns is the instructions Body
+	runs in all Iters passes, which is not always Iters
+	times its length.
+*/
+
+typedef struct {
+	char *Name;
+	const ui4b *Setup;
+	int SetupN;
+	const ui4b *Outer;
+	int OuterN;
+	ui5r OuterInsns;
+	const ui4b *Body;
+	int BodyN;
+	ui5r BodyInsns;
+	ui5r Iters;
+} Kernel;
+
+#define WordsN(a) ((int)(sizeof(a) / sizeof(ui4b)))
+
+static const ui4b AluBody[] = {
+	0xD481, /* add.l d1,d2 */
+	0x9483, /* sub.l d3,d2 */
+	0xB585, /* eor.l d2,d5 */
+	0xE78B, /* lsl.l #3,d3 */
+	0x8285, /* or.l d5,d1 */
+	0x4684 /* not.l d4 */
+};
+
+static const ui4b CopyOuter[] = {
+	0x41F9, 0x0001, 0x0000, /* lea $10000,a0 */
+	0x43F9, 0x0002, 0x0000 /* lea $20000,a1 */
+};
+
+static const ui4b CopyBody[] = {
+	0x22D8 /* move.l (a0)+,(a1)+ */
+};
+
+static const ui4b BranchBody[] = {
+	0x5281, /* addq.l #1,d1 */
+	0x0801, 0x0000, /* btst #0,d1 */
+	0x6702, /* beq.s 1$ */
+	0x5282, /* addq.l #1,d2 */
+	0x6102, /* 1$: bsr.s 2$ */
+	0x6004, /* bra.s 3$ */
+	0xD681, /* 2$: add.l d1,d3 */
+	0x4E75 /* rts */
+		/* 3$: */
+};
+
+static const ui4b MovemBody[] = {
+	0x48E7, 0x7EF8, /* movem.l d1-d6/a0-a4,-(sp) */
+	0x4CDF, 0x1F7E /* movem.l (sp)+,d1-d6/a0-a4 */
+};
+
+static const ui4b DivSetup[] = {
+	0x7607, /* moveq #7,d3 */
+	0x283C, 0x0001, 0x86A0 /* move.l #100000,d4 */
+};
+
+static const ui4b DivBody[] = {
+	0x2204, /* move.l d4,d1 */
+	0x82C3, /* divu.w d3,d1 */
+	0x2404, /* move.l d4,d2 */
+	0x85C3 /* divs.w d3,d2 */
+};
+
+static const ui4b BcdOuter[] = {
+	0x41F9, 0x0001, 0x0100, /* lea $10100,a0 */
+	0x43F9, 0x0002, 0x0100 /* lea $20100,a1 */
+};
+
+static const ui4b BcdBody[] = {
+	0xC308, /* abcd -(a0),-(a1) */
+	0x8501 /* sbcd d1,d2 */
+};
+
+static const ui4b MixedBody[] = {
+	0x2218, /* move.l (a0)+,d1 */
+	0xD481, /* add.l d1,d2 */
+	0xE489, /* lsr.l #2,d1 */
+	0xC641, /* and.w d1,d3 */
+	0x32C3, /* move.w d3,(a1)+ */
+	0x4A82, /* tst.l d2 */
+	0x56C6, /* sne d6 */
+	0x4842, /* swap d2 */
+	0x48C3, /* ext.l d3 */
+	0xB784, /* eor.l d3,d4 */
+	0xBA84, /* cmp.l d4,d5 */
+	0xC945 /* exg d4,d5 */
+};
+
+#if Use68020
+static const ui4b MulDivLSetup[] = {
+	0x7607, /* moveq #7,d3 */
+	0x283C, 0x1234, 0x5678 /* move.l #$12345678,d4 */
+};
+
+static const ui4b MulDivLBody[] = {
+	0x2204, /* move.l d4,d1 */
+	0x4C43, 0x1001, /* divu.l d3,d1 */
+	0x4C03, 0x1000, /* mulu.l d3,d1 */
+	0x4C03, 0x1C02 /* muls.l d3,d2:d1 */
+};
+
+static const ui4b BitFieldSetup[] = {
+	0x283C, 0x1234, 0x5678 /* move.l #$12345678,d4 */
+};
+
+static const ui4b BitFieldBody[] = {
+	0xE9C4, 0x20CB, /* bfextu d4{3:11},d2 */
+	0xEFC5, 0x2149, /* bfins d2,d5{5:9} */
+	0xEBC4, 0x3193 /* bfexts d4{6:19},d3 */
+};
+#endif
+
+#if Use68020 && EmFPU
+static const ui4b FpuSetup[] = {
+	0xF23C, 0x4000, 0x0000, 0x0000, /* fmove.l #0,fp0 */
+	0xF23C, 0x4080, 0x0000, 0x0003 /* fmove.l #3,fp1 */
+};
+
+static const ui4b FpuOuter[] = {
+	0xF23C, 0x4100, 0x0000, 0x0003, /* fmove.l #3,fp2 */
+	0xF23C, 0x4180, 0x000F, 0x4240 /* fmove.l #1000000,fp3 */
+};
+
+static const ui4b FpuBody[] = {
+	0xF200, 0x0422, /* fadd.x fp1,fp0 */
+	0xF200, 0x0523, /* fmul.x fp1,fp2 */
+	0xF200, 0x05A0 /* fdiv.x fp1,fp3 */
+};
+#endif
+
+#define KernelWords(a) a, WordsN(a)
+
+static const Kernel Kernels[] = {
+	{ "alu",
+		NULL, 0,
+		NULL, 0, 0,
+		KernelWords(AluBody), 6 * 256, 256 },
+	{ "memcopy",
+		NULL, 0,
+		KernelWords(CopyOuter), 2,
+		KernelWords(CopyBody), 1024, 1024 },
+	{ "branch",
+		NULL, 0,
+		NULL, 0, 0,
+		KernelWords(BranchBody), 7 * 256 + 128, 256 },
+	{ "movem",
+		NULL, 0,
+		NULL, 0, 0,
+		KernelWords(MovemBody), 2 * 256, 256 },
+	{ "divide",
+		KernelWords(DivSetup),
+		NULL, 0, 0,
+		KernelWords(DivBody), 4 * 256, 256 },
+	{ "bcd",
+		NULL, 0,
+		KernelWords(BcdOuter), 2,
+		KernelWords(BcdBody), 2 * 256, 256 },
+	{ "mixed",
+		NULL, 0,
+		KernelWords(CopyOuter), 2,
+		KernelWords(MixedBody), 12 * 256, 256 },
+#if Use68020
+	{ "muldivl",
+		KernelWords(MulDivLSetup),
+		NULL, 0, 0,
+		KernelWords(MulDivLBody), 4 * 256, 256 },
+	{ "bitfield",
+		KernelWords(BitFieldSetup),
+		NULL, 0, 0,
+		KernelWords(BitFieldBody), 3 * 256, 256 },
+#endif
+#if Use68020 && EmFPU
+	{ "fpu",
+		KernelWords(FpuSetup),
+		KernelWords(FpuOuter), 2,
+		KernelWords(FpuBody), 3 * 64, 64 },
+#endif
+	{ NULL }
+};
+
+static ui3b *ram;
+static ui3b ipl = 0;
+static ATTer att;
+
+static void PutWord(ui5r a, ui4r v)
+{
+	ram[a] = v >> 8;
+	ram[a + 1] = v;
+}
+
+static ui5r GetLong(ui5r a)
+{
+	return ((ui5r)ram[a] << 24) | ((ui5r)ram[a + 1] << 16)
+		| ((ui5r)ram[a + 2] << 8) | (ui5r)ram[a + 3];
+}
+
+static ui5r PutWords(ui5r a, const ui4b *p, int n)
+{
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		PutWord(a, p[i]);
+		a += 2;
+	}
+
+	return a;
+}
+
+/*
+	lay out the kernel as
+
+		lea $3000,a5
+		moveq #0,d7
+		<Setup>
+	outer:
+		<Outer>
+		move.w #Iters-1,d0
+	inner:
+		<Body>
+		dbra d0,inner
+		addq.l #1,d7
+		move.l d7,(a5)
+		bra.w outer
+
+	and return the instructions in one pass of the outer loop
+*/
+static ui5r LoadKernel(const Kernel *k)
+{
+	ui5r a = kCodeAddr;
+	ui5r outer;
+	ui5r inner;
+	ui5r i;
+
+	memset(ram, 0, kRAMsz);
+	for (i = 0; i < 0x1000; ++i) {
+		ram[kSrcAddr + i] = (ui3b)(i * 0x25 + 0x11);
+	}
+
+	PutWord(0, kStackAddr >> 16);
+	PutWord(2, kStackAddr & 0xFFFF);
+	PutWord(4, kCodeAddr >> 16);
+	PutWord(6, kCodeAddr & 0xFFFF);
+
+	PutWord(a, 0x4BF9); /* lea $3000,a5 */
+	PutWord(a + 2, kCountAddr >> 16);
+	PutWord(a + 4, kCountAddr & 0xFFFF);
+	PutWord(a + 6, 0x7E00); /* moveq #0,d7 */
+	a = PutWords(a + 8, k->Setup, k->SetupN);
+	outer = a;
+	a = PutWords(a, k->Outer, k->OuterN);
+	PutWord(a, 0x303C); /* move.w #Iters-1,d0 */
+	PutWord(a + 2, k->Iters - 1);
+	inner = a + 4;
+	a = PutWords(inner, k->Body, k->BodyN);
+	PutWord(a, 0x51C8); /* dbra d0,inner */
+	PutWord(a + 2, inner - (a + 2));
+	PutWord(a + 4, 0x5287); /* addq.l #1,d7 */
+	PutWord(a + 6, 0x2A87); /* move.l d7,(a5) */
+	PutWord(a + 8, 0x6000); /* bra.w outer */
+	PutWord(a + 10, outer - (a + 10));
+
+	return k->OuterInsns + 1 + k->BodyInsns + k->Iters + 3;
+}
+
+static double NowNs(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void RunCycles(ui5r n)
+{
+	NextiCount += n;
+	m68k_go_nCycles(n);
+}
+
+static void RunKernel(const Kernel *k, int Reps, ui5r Budget)
+{
+	ui5r PerPass = LoadKernel(k);
+	ui5r c0;
+	double t0;
+	double t;
+	double insns;
+	double Best = 0;
+	double BestInsns = 0;
+	int i;
+
+	m68k_reset();
+
+	/* get past the setup, and warm the host caches */
+	RunCycles(Budget / 16);
+
+	for (i = 0; i < Reps; ++i) {
+		c0 = GetLong(kCountAddr);
+		t0 = NowNs();
+		RunCycles(Budget);
+		t = NowNs() - t0;
+		insns = (double)(GetLong(kCountAddr) - c0) * PerPass;
+		if ((insns > 0) && ((0 == i) || (t / insns < Best / BestInsns)))
+		{
+			Best = t;
+			BestInsns = insns;
+		}
+	}
+
+	if (BestInsns <= 0) {
+		fprintf(stderr, "m68bench: %s did not get around its loop\n",
+			k->Name);
+	} else {
+		printf("%s,%.0f,%lu,%.3f,%.3f\n", k->Name, BestInsns,
+			(unsigned long)(Budget / kCycleScale),
+			Best / BestInsns, Best * kCycleScale / Budget);
+	}
+}
+
+static blnr Wanted(char *Name, int argc, char **argv, int i)
+{
+	if (i == argc) {
+		return trueblnr;
+	}
+	for (; i < argc; ++i) {
+		if (0 == strcmp(argv[i], Name)) {
+			return trueblnr;
+		}
+	}
+	return falseblnr;
+}
+
+int main(int argc, char **argv)
+{
+	int Reps = kDefaultReps;
+	long Mcycles = kDefaultMcycles;
+	const Kernel *k;
+	int i = 1;
+
+	while ((i + 1 < argc) && ('-' == argv[i][0])) {
+		if (0 == strcmp(argv[i], "-r")) {
+			Reps = atoi(argv[i + 1]);
+		} else if (0 == strcmp(argv[i], "-c")) {
+			Mcycles = atol(argv[i + 1]);
+		} else {
+			break;
+		}
+		i += 2;
+	}
+	if (((i < argc) && ('-' == argv[i][0]))
+		|| (Reps < 1) || (Mcycles < 1) || (Mcycles > kMaxMcycles))
+	{
+		fprintf(stderr,
+			"usage: m68bench [-r reps] [-c Mcycles] [kernel ...]\n");
+		return 1;
+	}
+
+	ram = calloc(kRAMsz + 16, 1);
+	if (NULL == ram) {
+		fprintf(stderr, "m68bench: out of memory\n");
+		return 1;
+	}
+	att.cmpmask = 0;
+	att.cmpvalu = 0;
+	att.Access = kATTA_readwritereadymask;
+	att.usemask = kRAMsz - 1;
+	att.usebase = ram;
+
+	MINEM68K_Init(&ipl);
+	SetHeadATTel(&att);
+
+	printf("kernel,insns,cycles,ns_per_insn,ns_per_cycle\n");
+	for (k = Kernels; NULL != k->Name; ++k) {
+		if (Wanted(k->Name, argc, argv, i)) {
+			RunKernel(k, Reps,
+				(ui5r)Mcycles * 1000000 * kCycleScale);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,614 @@
+/*
+	M68MULDV.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	host tool to check the 68020 MULU.L, MULS.L, DIVU.L and
+	DIVS.L of the CPU emulation (src/MINEM68K.c), against
+	plain 64 bit arithmetic here, and against another build
+	of the CPU emulation.
+
+	build with the configuration of a 68020 variant, once as
+	it is, and once with the portable 64 bit code that
+	mul_unsigned and div_unsigned had before they used the
+	host's 64 bit integers:
+		cc -m32 -O2 -DHaveGlbReg=0 -o m68muldv \
+			-Ivariants/MacII8bpp/cfg -Isrc \
+			tools/M68MULDV.c src/MINEM68K.c src/M68KITAB.c
+		cc -m32 -O2 -DHaveGlbReg=0 -DHaveRealui6b=0 \
+			-o m68muldv0 ...
+	(-m32 and HaveGlbReg as for M68BENCH.c.)
+
+	m68muldv [-n count] [-s seed] [-v]
+		run each form of the instructions on every pair of a
+		list of edge case operands (0, 1, -1, 0x80000000,
+		0x7FFFFFFF and so on, and every triple of them for
+		the 64 bit dividends), then on count (default 100000)
+		random ones from seed (default 1), with all starting
+		flags, check each result, and print
+
+		cases,wrong
+
+	and list the first few wrong ones on stderr. With -v,
+	each case and what it left is printed too, so that two
+	builds can be compared:
+		m68muldv -v > new.txt
+		m68muldv0 -v > old.txt
+		cmp old.txt new.txt
+	which also covers the flags not checked here, N and Z
+	after a divide overflow (undefined on a real 68020), and
+	after a 32 bit multiply where the emulation takes them from
+	the whole 64 bit product but a real 68020 from the 32 bit
+	result. A divisor of 0 is not tried, it traps.
+*/
+
+#include "SYSDEPNS.h"
+
+#include "ENDIANAC.h"
+#include "MYOSGLUE.h"
+#include "EMCONFIG.h"
+#include "GLOBGLUE.h"
+#include "M68KITAB.h"
+#include "MINEM68K.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if ! Use68020
+#error "M68MULDV needs the configuration of a 68020 variant"
+#endif
+
+#define kRAMsz 0x00100000
+#define kCodeAddr 0x1000
+#define kStackAddr 0x0C00
+#define kDoneAddr 0x0E00 /* set at the end of a batch */
+#define kResAddr 0x80000
+
+#define kBatchN 4096 /* cases run at a time */
+#define kMaxWrongShown 16
+
+#define kDefaultCount 100000
+
+typedef char ui5bIs32Bits[(4 == sizeof(ui5b)) ? 1 : -1];
+
+/* what the CPU emulation needs from the rest of the emulator */
+
+GLOBALVAR ui5r RAMa_Size = kRAMa_Size;
+GLOBALVAR ui5r RAMb_Size = kRAMb_Size;
+GLOBALVAR iCountt NextiCount = 0;
+
+GLOBALFUNC iCountt GetCuriCount(void)
+{
+	return NextiCount - GetCyclesRemaining();
+}
+
+#if dbglog_HAVE
+GLOBALPROC DoReportAbnormalID(ui4r id, char *s)
+{
+	fprintf(stderr, "m68muldv: abnormal %04X %s\n", id, s);
+}
+#else
+GLOBALPROC DoReportAbnormalID(ui4r id)
+{
+	fprintf(stderr, "m68muldv: abnormal %04X\n", id);
+}
+#endif
+
+GLOBALFUNC blnr MemAccessNtfy(ATTep pT)
+{
+	UnusedParam(pT);
+	return falseblnr;
+}
+
+GLOBALPROC customreset(void)
+{
+}
+
+#if WantTraceRing || WantTrapProfile
+GLOBALOSGLUFUNC blnr TraceFile_Open(char *Name)
+{
+	UnusedParam(Name);
+	return falseblnr;
+}
+
+GLOBALOSGLUPROC TraceFile_Write(ui3p p, ui5r L)
+{
+	UnusedParam(p);
+	UnusedParam(L);
+}
+
+GLOBALOSGLUPROC TraceFile_Close(void)
+{
+}
+#endif
+
+#if WantTrapProfile
+GLOBALOSGLUFUNC ui5r GetMicroseconds(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+/*
+	Each form takes its source from d1, and Dl or Dq is d2.
+	Dh or Dr, when there is one, is d3.
+*/
+
+typedef struct {
+	char *Name;
+	ui4r op;
+	ui4r ext;
+} Form;
+
+static const Form Forms[] = {
+	{ "mulu.l d1,d2", 0x4C01, 0x2000 },
+	{ "muls.l d1,d2", 0x4C01, 0x2800 },
+	{ "mulu.l d1,d3:d2", 0x4C01, 0x2403 },
+	{ "muls.l d1,d3:d2", 0x4C01, 0x2C03 },
+	{ "divu.l d1,d2", 0x4C41, 0x2002 },
+	{ "divs.l d1,d2", 0x4C41, 0x2802 },
+	{ "divul.l d1,d3:d2", 0x4C41, 0x2003 },
+	{ "divsl.l d1,d3:d2", 0x4C41, 0x2803 },
+	{ "divu.l d1,d3:d2", 0x4C41, 0x2403 },
+	{ "divs.l d1,d3:d2", 0x4C41, 0x2C03 },
+	{ NULL }
+};
+
+#define FormIsDiv(f) (0 != ((f)->op & 0x0040))
+#define FormIsSigned(f) (0 != ((f)->ext & 0x0800))
+#define FormIs64(f) (0 != ((f)->ext & 0x0400))
+
+static const ui5b Specials[] = {
+	0x00000000, 0x00000001, 0x00000002, 0x00000007,
+	0x00007FFF, 0x00008000, 0x0000FFFF, 0x00010000,
+	0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFF0000,
+	0xFFFF8000, 0xFFFFFFF9, 0xFFFFFFFE, 0xFFFFFFFF
+};
+
+#define SpecialsN ((int)(sizeof(Specials) / sizeof(ui5b)))
+
+typedef struct {
+	const Form *f;
+	ui5b d[3]; /* d1, d2, d3 */
+	ui3b ccr;
+} Case;
+
+typedef struct {
+	ui5b d[3];
+	ui3b ccr;
+} Result;
+
+static ui3b *ram;
+static ui3b ipl = 0;
+static ATTer att;
+
+static Case Cases[kBatchN];
+static int CasesN = 0;
+
+static ui5r NCases = 0;
+static ui5r NWrong = 0;
+static blnr Verbose = falseblnr;
+
+static ui5b RandState;
+
+static ui5b Rand32(void)
+{
+	/* xorshift, so every host gives the same cases */
+	RandState ^= RandState << 13;
+	RandState ^= RandState >> 17;
+	RandState ^= RandState << 5;
+	return RandState;
+}
+
+static void PutWord(ui5r a, ui4r v)
+{
+	ram[a] = v >> 8;
+	ram[a + 1] = v;
+}
+
+static void PutLong(ui5r a, ui5r v)
+{
+	PutWord(a, v >> 16);
+	PutWord(a + 2, v & 0xFFFF);
+}
+
+static ui5r GetLong(ui5r a)
+{
+	return ((ui5r)ram[a] << 24) | ((ui5r)ram[a + 1] << 16)
+		| ((ui5r)ram[a + 2] << 8) | (ui5r)ram[a + 3];
+}
+
+/*
+	what the instruction should leave, worked out with the
+	host's 64 bit integers. Returns which bits of the ccr
+	are to be compared.
+*/
+static ui3r Model(const Case *c, Result *r)
+{
+	const Form *f = c->f;
+	ui5b a = c->d[0];
+	ui6b p;
+	ui6b n;
+	ui6b q;
+	ui6b m;
+	ui5b lo;
+	ui3r N;
+	ui3r Z;
+	ui3r V = 0;
+	ui3r Mask = 0x1F;
+
+	r->d[0] = c->d[0];
+	r->d[1] = c->d[1];
+	r->d[2] = c->d[2];
+
+	if (! FormIsDiv(f)) {
+		if (FormIsSigned(f)) {
+			p = (ui6b)((si6b)(si5b)a * (si6b)(si5b)c->d[1]);
+		} else {
+			p = (ui6b)a * c->d[1];
+		}
+		lo = (ui5b)p;
+		r->d[1] = lo;
+		N = (ui3r)(p >> 63);
+		Z = (0 == p);
+		if (FormIs64(f)) {
+			r->d[2] = (ui5b)(p >> 32);
+		} else {
+			if (FormIsSigned(f)) {
+				V = (p != (ui6b)(si6b)(si5b)lo);
+			} else {
+				V = (0 != (p >> 32));
+			}
+			if ((N != (lo >> 31)) || (Z != (0 == lo))) {
+				/* the two readings differ, see above */
+				Mask &= ~ 0x0C;
+			}
+		}
+	} else {
+		blnr NegQuot = falseblnr;
+		blnr NegRem = falseblnr;
+
+		if (FormIs64(f)) {
+			n = ((ui6b)c->d[2] << 32) | c->d[1];
+		} else if (FormIsSigned(f)) {
+			n = (ui6b)(si6b)(si5b)c->d[1];
+		} else {
+			n = c->d[1];
+		}
+		m = a;
+		if (FormIsSigned(f)) {
+			if (0 != (n >> 63)) {
+				n = - n;
+				NegRem = trueblnr;
+			}
+			if (0 != (a >> 31)) {
+				m = (ui5b)(- a);
+				NegQuot = trueblnr;
+			}
+			NegQuot = (NegQuot != NegRem);
+		}
+		q = n / m;
+		n = n % m;
+
+		if (FormIsSigned(f)
+			? (q > (NegQuot ? 0x80000000 : 0x7FFFFFFF))
+			: (q > 0xFFFFFFFF))
+		{
+			/* overflow, registers left alone */
+			V = 1;
+			N = Z = 0;
+			Mask = 0x13;
+		} else {
+			if (NegQuot) {
+				q = - q;
+			}
+			if (NegRem) {
+				n = - n;
+			}
+			r->d[(f->ext & 7) - 1] = (ui5b)n;
+			r->d[((f->ext >> 12) & 7) - 1] = (ui5b)q;
+			N = (ui3r)((ui5b)q >> 31);
+			Z = (0 == (ui5b)q);
+		}
+	}
+
+	r->ccr = (c->ccr & 0x10) | (N << 3) | (Z << 2) | (V << 1);
+
+	return Mask;
+}
+
+/*
+	lay out the batch as
+
+		lea $0E00,a5
+		lea $80000,a6
+	then for each case
+		move.l #d1,d1
+		move.l #d2,d2
+		move.l #d3,d3
+		move #ccr,ccr
+		<the instruction>
+		move.w ccr,d0
+		movem.l d0-d3,(a6)
+		lea 16(a6),a6
+	and at the end
+		moveq #1,d7
+		move.l d7,(a5)
+		bra.s *
+*/
+static void LoadBatch(void)
+{
+	ui5r a = kCodeAddr;
+	int i;
+	int j;
+
+	memset(ram, 0, kRAMsz);
+
+	PutLong(0, kStackAddr);
+	PutLong(4, kCodeAddr);
+
+	PutWord(a, 0x4BF9); /* lea $0E00,a5 */
+	PutLong(a + 2, kDoneAddr);
+	PutWord(a + 6, 0x4DF9); /* lea $80000,a6 */
+	PutLong(a + 8, kResAddr);
+	a += 12;
+	for (i = 0; i < CasesN; ++i) {
+		for (j = 0; j < 3; ++j) {
+			PutWord(a, 0x223C + (j << 9)); /* move.l #,d1+j */
+			PutLong(a + 2, Cases[i].d[j]);
+			a += 6;
+		}
+		PutWord(a, 0x44FC); /* move #,ccr */
+		PutWord(a + 2, Cases[i].ccr);
+		PutWord(a + 4, Cases[i].f->op);
+		PutWord(a + 6, Cases[i].f->ext);
+		PutWord(a + 8, 0x42C0); /* move.w ccr,d0 */
+		PutWord(a + 10, 0x48D6); /* movem.l d0-d3,(a6) */
+		PutWord(a + 12, 0x000F);
+		PutWord(a + 14, 0x4DEE); /* lea 16(a6),a6 */
+		PutWord(a + 16, 0x0010);
+		a += 18;
+	}
+	PutWord(a, 0x7E01); /* moveq #1,d7 */
+	PutWord(a + 2, 0x2A87); /* move.l d7,(a5) */
+	PutWord(a + 4, 0x60FE); /* bra.s * */
+}
+
+static void RunCycles(ui5r n)
+{
+	NextiCount += n;
+	m68k_go_nCycles(n);
+}
+
+static blnr RunBatch(void)
+{
+	Result r;
+	Result w;
+	ui5r a;
+	ui3r Mask;
+	int i;
+	int j;
+
+	if (0 == CasesN) {
+		return trueblnr;
+	}
+
+	LoadBatch();
+	m68k_reset();
+	for (i = 0; 0 == GetLong(kDoneAddr); ++i) {
+		if (i == 64) {
+			fprintf(stderr, "m68muldv: a batch did not finish\n");
+			return falseblnr;
+		}
+		RunCycles((ui5r)1000000 * kCycleScale);
+	}
+
+	for (i = 0; i < CasesN; ++i) {
+		a = kResAddr + 16 * i;
+		r.ccr = GetLong(a) & 0x1F;
+		for (j = 0; j < 3; ++j) {
+			r.d[j] = GetLong(a + 4 + 4 * j);
+		}
+		Mask = Model(&Cases[i], &w);
+
+		if (Verbose) {
+			printf("%04X %04X %02X %08lX %08lX %08lX"
+				" : %02X %08lX %08lX %08lX\n",
+				(unsigned)Cases[i].f->op, (unsigned)Cases[i].f->ext,
+				(unsigned)Cases[i].ccr,
+				(unsigned long)Cases[i].d[0],
+				(unsigned long)Cases[i].d[1],
+				(unsigned long)Cases[i].d[2],
+				(unsigned)r.ccr, (unsigned long)r.d[0],
+				(unsigned long)r.d[1], (unsigned long)r.d[2]);
+		}
+
+		if ((0 != ((r.ccr ^ w.ccr) & Mask))
+			|| (r.d[0] != w.d[0]) || (r.d[1] != w.d[1])
+			|| (r.d[2] != w.d[2]))
+		{
+			if (NWrong < kMaxWrongShown) {
+				fprintf(stderr,
+					"m68muldv: %s with %08lX %08lX %08lX"
+					" gave %02X %08lX %08lX,"
+					" not %02X %08lX %08lX (ccr mask %02X)\n",
+					Cases[i].f->Name,
+					(unsigned long)Cases[i].d[0],
+					(unsigned long)Cases[i].d[1],
+					(unsigned long)Cases[i].d[2],
+					(unsigned)r.ccr,
+					(unsigned long)r.d[1], (unsigned long)r.d[2],
+					(unsigned)w.ccr,
+					(unsigned long)w.d[1], (unsigned long)w.d[2],
+					(unsigned)Mask);
+			}
+			++NWrong;
+		}
+	}
+
+	NCases += CasesN;
+	CasesN = 0;
+
+	return trueblnr;
+}
+
+static blnr AddCase(const Form *f, ui5b d1, ui5b d2, ui5b d3)
+{
+	Case *c = &Cases[CasesN];
+
+	if (FormIsDiv(f) && (0 == d1)) {
+		return trueblnr;
+	}
+	c->f = f;
+	c->d[0] = d1;
+	c->d[1] = d2;
+	c->d[2] = d3;
+	c->ccr = (NCases + CasesN) & 0x1F;
+	if (++CasesN == kBatchN) {
+		return RunBatch();
+	}
+	return trueblnr;
+}
+
+static blnr AddEdgeCases(void)
+{
+	const Form *f;
+	int i;
+	int j;
+	int k;
+
+	for (f = Forms; NULL != f->Name; ++f) {
+		for (i = 0; i < SpecialsN; ++i) {
+			for (j = 0; j < SpecialsN; ++j) {
+				if (FormIsDiv(f) && FormIs64(f)) {
+					for (k = 0; k < SpecialsN; ++k) {
+						if (! AddCase(f, Specials[i], Specials[j],
+							Specials[k]))
+						{
+							return falseblnr;
+						}
+					}
+				} else if (! AddCase(f, Specials[i], Specials[j],
+					0x5A5A5A5A))
+				{
+					return falseblnr;
+				}
+			}
+		}
+	}
+
+	return trueblnr;
+}
+
+static ui5b RandOperand(void)
+{
+	ui5b v = Rand32();
+
+	switch (Rand32() & 3) {
+		case 0:
+			return Specials[v % SpecialsN];
+		case 1:
+			return v & 0xFFFF;
+		case 2:
+			return - (v & 0xFFFF);
+		default:
+			return v;
+	}
+}
+
+static blnr AddRandomCases(ui5r n)
+{
+	const Form *f;
+	ui5b d1;
+	ui5b d3;
+	ui5r i;
+
+	for (i = 0; i < n; ++i) {
+		f = &Forms[Rand32() % (sizeof(Forms) / sizeof(Form) - 1)];
+		do {
+			d1 = RandOperand();
+		} while (FormIsDiv(f) && (0 == d1));
+		if (FormIsDiv(f) && FormIs64(f) && (0 != (Rand32() & 1))) {
+			/* a high half small enough that it mostly fits */
+			d3 = Rand32() % ((d1 >> 1) | 1);
+			if (FormIsSigned(f) && (0 != (Rand32() & 1))) {
+				d3 = ~ d3;
+			}
+		} else {
+			d3 = RandOperand();
+		}
+		if (! AddCase(f, d1, RandOperand(), d3)) {
+			return falseblnr;
+		}
+	}
+
+	return trueblnr;
+}
+
+int main(int argc, char **argv)
+{
+	long Count = kDefaultCount;
+	unsigned long Seed = 1;
+	int i = 1;
+
+	while ((i < argc) && ('-' == argv[i][0])) {
+		if (0 == strcmp(argv[i], "-v")) {
+			Verbose = trueblnr;
+			i += 1;
+		} else if ((0 == strcmp(argv[i], "-n")) && (i + 1 < argc)) {
+			Count = atol(argv[i + 1]);
+			i += 2;
+		} else if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc)) {
+			Seed = strtoul(argv[i + 1], NULL, 0);
+			i += 2;
+		} else {
+			break;
+		}
+	}
+	if ((i < argc) || (Count < 0) || (0 == (ui5b)Seed)) {
+		fprintf(stderr, "usage: m68muldv [-n count] [-s seed] [-v]\n");
+		return 1;
+	}
+	RandState = (ui5b)Seed;
+
+	ram = calloc(kRAMsz + 16, 1);
+	if (NULL == ram) {
+		fprintf(stderr, "m68muldv: out of memory\n");
+		return 1;
+	}
+	att.cmpmask = 0;
+	att.cmpvalu = 0;
+	att.Access = kATTA_readwritereadymask;
+	att.usemask = kRAMsz - 1;
+	att.usebase = ram;
+
+	MINEM68K_Init(&ipl);
+	SetHeadATTel(&att);
+
+	if (! (AddEdgeCases()
+		&& AddRandomCases((ui5r)Count)
+		&& RunBatch()))
+	{
+		return 1;
+	}
+
+	printf("cases,wrong\n%lu,%lu\n",
+		(unsigned long)NCases, (unsigned long)NWrong);
+
+	return (0 == NWrong) ? 0 : 1;
+}
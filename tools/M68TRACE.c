@@ -0,0 +1,428 @@
+/*
+	M68TRACE.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	host tool to decode the instruction trace file saved by
+	m68k_TraceRingDump (src/MINEM68K.c), using the emulator's
+	own disassembler.
+
+	build with the configuration of the variant that made the
+	trace, for example:
+		cc -O2 -o m68trace -Ivariants/MacII8bpp/cfg -Isrc \
+			tools/M68TRACE.c
+
+	m68trace m68trace.bin
+		cycles spent in each routine, most expensive first
+	m68trace -l [n] m68trace.bin
+		disassemble the last n (default 64) instructions
+
+	A routine is the target of a JSR, BSR or A-line trap,
+	and it ends when the pc gets back to the instruction
+	after the call. Exclusive cycles are those spent in the
+	routine itself, inclusive also counts what it called.
+	Calls still open when the trace ends are counted up to
+	the end.
+*/
+
+#include "SYSDEPNS.h"
+
+#include "ENDIANAC.h"
+#include "MYOSGLUE.h"
+#include "EMCONFIG.h"
+#include "GLOBGLUE.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kTraceFileMagic 0x4D363854
+#define kTraceFileHeaderSz 32
+#define kTraceFileRecSz 12
+#define kTraceFileFlag68020 1
+#define kTraceRecMarker 1
+
+#define kMaxDepth 256
+#define kMaxRoutines 16384
+#define kDefaultListN 64
+#define kSummaryN 40
+
+static unsigned long nrecs;
+static unsigned long *pcs;
+static unsigned long *ops;
+static unsigned long long *cycs; /* scaled cycles since the first */
+static unsigned long cycscale;
+static unsigned char *ram;
+static unsigned long ramsz;
+static unsigned char *rom;
+static unsigned long romsz;
+static unsigned long rombase;
+
+static int Quiet = 0;
+
+/* what the disassembler needs from the rest of the emulator */
+
+GLOBALOSGLUPROC dbglog_writeCStr(char *s)
+{
+	if (! Quiet) {
+		fputs(s, stdout);
+	}
+}
+
+GLOBALOSGLUPROC dbglog_writeReturn(void)
+{
+	if (! Quiet) {
+		fputc('\n', stdout);
+	}
+}
+
+GLOBALOSGLUPROC dbglog_writeHex(ui5r x)
+{
+	if (! Quiet) {
+		printf("%lX", (unsigned long)x);
+	}
+}
+
+static ATTer att;
+
+GLOBALFUNC ATTep FindATTel(CPTR addr)
+{
+	ui5r a24 = addr & 0x00FFFFFF;
+
+	att.Access = kATTA_readreadymask;
+	if (((addr & 0xF0000000) == 0x40000000)
+		|| ((a24 >= rombase) && (a24 < rombase + 0x00100000)))
+	{
+		att.usebase = rom;
+		att.usemask = romsz - 1;
+	} else if (a24 < ramsz) {
+		att.usebase = ram;
+		att.usemask = ramsz - 1;
+	} else {
+		att.Access = 0;
+		att.usemask = 0;
+	}
+	att.cmpmask = ~ att.usemask;
+	att.cmpvalu = addr & att.cmpmask;
+
+	return &att;
+}
+
+/*
+	only now, so that DISAM68K.c doesn't include the headers
+	again. SYSDEPNS.h was read without it, so what they
+	declare, and DISAM68K.c's own global functions, are not
+	static, and so no warnings about unused ones.
+*/
+#define AllFiles
+#include "DISAM68K.c"
+
+static unsigned long get_long(unsigned char *p)
+{
+	return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+		| ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
+#define rec_pc(i) pcs[i]
+#define rec_cyc(i) cycs[i]
+#define rec_op(i) ops[i]
+
+static int fail(char *s)
+{
+	fprintf(stderr, "m68trace: %s\n", s);
+	return 1;
+}
+
+static int load_trace(char *path)
+{
+	FILE *f;
+	long L;
+	unsigned char *b;
+	unsigned char *p;
+	unsigned long flags;
+	unsigned long n;
+	unsigned long i;
+	unsigned long pc;
+	long togo;
+	long prevtogo = 0;
+	unsigned long long total = 0;
+	int started = 0;
+
+	if (NULL == (f = fopen(path, "rb"))) {
+		return fail("can not open trace");
+	}
+	if ((0 != fseek(f, 0, SEEK_END)) || ((L = ftell(f)) < 0)
+		|| (0 != fseek(f, 0, SEEK_SET)))
+	{
+		fclose(f);
+		return fail("can not size trace");
+	}
+	if ((L < kTraceFileHeaderSz)
+		|| (NULL == (b = malloc(L)))
+		|| (1 != fread(b, L, 1, f)))
+	{
+		fclose(f);
+		return fail("can not read trace");
+	}
+	fclose(f);
+
+	if (kTraceFileMagic != get_long(b)) {
+		return fail("not a trace file");
+	}
+	n = get_long(b + 4);
+	cycscale = get_long(b + 8);
+	ramsz = get_long(b + 12);
+	romsz = get_long(b + 16);
+	rombase = get_long(b + 20);
+	flags = get_long(b + 24);
+	if ((unsigned long)L != kTraceFileHeaderSz
+		+ n * kTraceFileRecSz + ramsz + romsz)
+	{
+		return fail("trace file is the wrong size");
+	}
+	if (((flags & kTraceFileFlag68020) != 0) != (Use68020 != 0)) {
+		fprintf(stderr,
+			"m68trace: built for the wrong CPU for this trace\n");
+	}
+	ram = b + kTraceFileHeaderSz + n * kTraceFileRecSz;
+	rom = ram + ramsz;
+
+	pcs = malloc(n * sizeof(*pcs));
+	ops = malloc(n * sizeof(*ops));
+	cycs = malloc(n * sizeof(*cycs));
+	if ((NULL == pcs) || (NULL == ops) || (NULL == cycs)) {
+		return fail("out of memory");
+	}
+
+	/*
+		the cycles field counts down, and the marker records
+		say when it was changed other than by running
+		instructions
+	*/
+	nrecs = 0;
+	for (i = 0; i < n; ++i) {
+		p = b + kTraceFileHeaderSz + i * kTraceFileRecSz;
+		pc = get_long(p);
+		togo = (long)(si5b)get_long(p + 4);
+		if ((0 == pc) && (0 == togo) && (0 == get_long(p + 8))) {
+			/* the ring had not filled up */
+		} else if (kTraceRecMarker == pc) {
+			if (started) {
+				total += prevtogo - togo;
+			}
+			prevtogo = togo + (long)(si5b)get_long(p + 8);
+			started = 1;
+		} else {
+			if (started) {
+				total += prevtogo - togo;
+			}
+			prevtogo = togo;
+			started = 1;
+			pcs[nrecs] = pc;
+			ops[nrecs] = get_long(p + 8);
+			cycs[nrecs] = total;
+			++nrecs;
+		}
+	}
+
+	return 0;
+}
+
+static void list_last(unsigned long n)
+{
+	unsigned long i;
+	unsigned long long c;
+
+	if (n > nrecs) {
+		n = nrecs;
+	}
+	for (i = nrecs - n; i < nrecs; ++i) {
+		c = (i + 1 < nrecs) ? (rec_cyc(i + 1) - rec_cyc(i)) : 0;
+		printf("%8llu ", c / cycscale);
+		dbglog_writeHex(rec_pc(i));
+		dbglog_writeCStr("  ");
+		Disasm_setpc(rec_pc(i));
+		m68k_Disasm_one();
+	}
+}
+
+typedef struct {
+	unsigned long entry;
+	unsigned long trap; /* A-line word, or 0 */
+	unsigned long calls;
+	unsigned long long excl;
+	unsigned long long incl;
+} Routine;
+
+typedef struct {
+	Routine *r;
+	unsigned long ret;
+	unsigned long long start;
+} Frame;
+
+static Routine routines[kMaxRoutines];
+static unsigned long nroutines = 0;
+static Frame stack[kMaxDepth];
+static int depth = 0;
+
+static Routine *find_routine(unsigned long entry, unsigned long trap)
+{
+	unsigned long i;
+
+	for (i = 0; i < nroutines; ++i) {
+		if ((routines[i].entry == entry)
+			&& (routines[i].trap == trap))
+		{
+			return &routines[i];
+		}
+	}
+	if (nroutines == kMaxRoutines) {
+		return &routines[0];
+	}
+	routines[nroutines].entry = entry;
+	routines[nroutines].trap = trap;
+
+	return &routines[nroutines++];
+}
+
+static void close_frames(int newdepth, unsigned long long cyc)
+{
+	while (depth > newdepth) {
+		--depth;
+		stack[depth].r->incl += cyc - stack[depth].start;
+	}
+}
+
+static int cmp_excl(const void *a, const void *b)
+{
+	unsigned long long x = ((Routine *)a)->excl;
+	unsigned long long y = ((Routine *)b)->excl;
+
+	return (x < y) ? 1 : (x > y) ? -1 : 0;
+}
+
+static void summarize(void)
+{
+	unsigned long i;
+	unsigned long pc;
+	unsigned long op;
+	unsigned long long cyc;
+	unsigned long next;
+	unsigned long long total;
+	int d;
+	Routine *r;
+
+	if (nrecs < 2) {
+		return;
+	}
+
+	stack[0].r = find_routine(rec_pc(0), 0);
+	stack[0].ret = 0xFFFFFFFF;
+	stack[0].start = rec_cyc(0);
+	stack[0].r->calls = 1;
+	depth = 1;
+
+	Quiet = 1;
+	for (i = 0; i + 1 < nrecs; ++i) {
+		pc = rec_pc(i);
+		op = rec_op(i);
+		cyc = rec_cyc(i);
+
+		/* back at the return address of an open call? */
+		for (d = depth - 1; d > 0; --d) {
+			if (stack[d].ret == pc) {
+				close_frames(d, cyc);
+				break;
+			}
+		}
+
+		stack[depth - 1].r->excl += rec_cyc(i + 1) - cyc;
+
+		if (((op & 0xFFC0) == 0x4E80) /* JSR */
+			|| ((op & 0xFF00) == 0x6100) /* BSR */
+			|| ((op & 0xF000) == 0xA000)) /* A-line trap */
+		{
+			if ((op & 0xF000) == 0xA000) {
+				next = pc + 2;
+				r = find_routine(0, op);
+			} else {
+				Disasm_setpc(pc);
+				m68k_Disasm_one();
+				next = Disasm_pc;
+				r = find_routine(rec_pc(i + 1), 0);
+			}
+			if (depth < kMaxDepth) {
+				stack[depth].r = r;
+				stack[depth].ret = next;
+				stack[depth].start = rec_cyc(i + 1);
+				++depth;
+				++r->calls;
+			}
+		}
+	}
+	close_frames(0, rec_cyc(nrecs - 1));
+	Quiet = 0;
+
+	total = rec_cyc(nrecs - 1) - rec_cyc(0);
+	printf("%lu instructions, %llu cycles\n\n", nrecs,
+		total / cycscale);
+	printf("%12s %12s %6s %8s  routine\n",
+		"exclusive", "inclusive", "%", "calls");
+
+	qsort(routines, nroutines, sizeof(Routine), cmp_excl);
+	for (i = 0; (i < nroutines) && (i < kSummaryN); ++i) {
+		r = &routines[i];
+		printf("%12llu %12llu %6.2f %8lu  ",
+			r->excl / cycscale, r->incl / cycscale,
+			(0 == total) ? 0.0 : 100.0 * r->excl / total, r->calls);
+		if (0 != r->trap) {
+			printf("trap %04lX\n", r->trap);
+		} else {
+			dbglog_writeHex(r->entry);
+			dbglog_writeCStr("  ");
+			Disasm_setpc(r->entry);
+			m68k_Disasm_one();
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long n = kDefaultListN;
+	int list = 0;
+	int i = 1;
+
+	if ((i < argc) && (0 == strcmp(argv[i], "-l"))) {
+		list = 1;
+		++i;
+		if ((i + 1 < argc)) {
+			n = strtoul(argv[i], NULL, 10);
+			++i;
+		}
+	}
+	if (i + 1 != argc) {
+		fprintf(stderr, "usage: m68trace [-l [n]] m68trace.bin\n");
+		return 1;
+	}
+	if (0 != load_trace(argv[i])) {
+		return 1;
+	}
+
+	if (list) {
+		list_last(n);
+	} else {
+		summarize();
+	}
+
+	return 0;
+}
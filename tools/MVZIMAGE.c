@@ -0,0 +1,262 @@
+/*
+	MVZIMAGE.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	host tool to convert disk images to and from the
+	compressed format described in src/DGLUCMPR.h
+
+	build with:
+		cc -O2 -o mvzimage tools/MVZIMAGE.c -lz
+
+	mvzimage [-s chunkshift] in.dsk out.mvz
+		compress a raw (or Disk Copy 4.2) image
+	mvzimage -d in.mvz out.dsk
+		expand a compressed image
+
+	Compressing an image that is already compressed expands
+	it first, which also drops chunks left behind by writes
+	from the emulator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define kCmpDskMagic 0x4D565A31
+#define kCmpDskHeaderSize 32
+#define kCmpDskMinChunkShift 9
+#define kCmpDskMaxChunkShift 16
+#define kDefaultChunkShift 15
+
+static unsigned long get_long(unsigned char *p)
+{
+	return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+		| ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
+static void put_long(unsigned char *p, unsigned long v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static int fail(char *s)
+{
+	fprintf(stderr, "mvzimage: %s\n", s);
+	return 1;
+}
+
+/*
+	read the whole of a (raw or compressed) image into memory
+*/
+static unsigned char *load_image(FILE *f, unsigned long *size)
+{
+	unsigned char h[kCmpDskHeaderSize];
+	unsigned char *img;
+	unsigned char *idx;
+	unsigned char *cbuf;
+	unsigned long n;
+	unsigned long i;
+	unsigned long shift;
+	unsigned long chunksz;
+	long L;
+
+	if ((0 != fseek(f, 0, SEEK_END)) || ((L = ftell(f)) < 0)) {
+		return NULL;
+	}
+	rewind(f);
+
+	if ((L >= kCmpDskHeaderSize)
+		&& (kCmpDskHeaderSize == fread(h, 1, kCmpDskHeaderSize, f))
+		&& (kCmpDskMagic == get_long(h)))
+	{
+		shift = get_long(h + 4);
+		*size = get_long(h + 8);
+		n = get_long(h + 12);
+		if ((shift < kCmpDskMinChunkShift) || (shift > kCmpDskMaxChunkShift)
+			|| (n != ((*size + (1UL << shift) - 1) >> shift)))
+		{
+			return NULL;
+		}
+		chunksz = 1UL << shift;
+		img = calloc(1, *size + 1);
+		idx = malloc(n * 8 + 1);
+		cbuf = malloc(chunksz);
+		if ((NULL == img) || (NULL == idx) || (NULL == cbuf)
+			|| (0 != fseek(f, get_long(h + 16), SEEK_SET))
+			|| (n * 8 != fread(idx, 1, n * 8, f)))
+		{
+			return NULL;
+		}
+		for (i = 0; i < n; ++i) {
+			unsigned long off = get_long(idx + 8 * i);
+			unsigned long clen = get_long(idx + 8 * i + 4);
+			unsigned long start = i << shift;
+			uLongf dlen = (*size - start > chunksz)
+				? chunksz : *size - start;
+
+			if (0 == clen) {
+				continue; /* zero chunk, already cleared */
+			}
+			if ((clen > chunksz) || (0 != fseek(f, off, SEEK_SET))
+				|| (clen != fread(cbuf, 1, clen, f)))
+			{
+				return NULL;
+			}
+			if (clen == dlen) {
+				memcpy(img + start, cbuf, clen);
+			} else if (Z_OK != uncompress(img + start, &dlen, cbuf, clen)) {
+				return NULL;
+			}
+		}
+		free(cbuf);
+		free(idx);
+	} else {
+		*size = L;
+		img = malloc(L + 1);
+		rewind(f);
+		if ((NULL == img) || ((unsigned long)L != fread(img, 1, L, f))) {
+			return NULL;
+		}
+	}
+
+	return img;
+}
+
+static int save_compressed(FILE *f, unsigned char *img, unsigned long size,
+	unsigned long shift)
+{
+	unsigned char h[kCmpDskHeaderSize];
+	unsigned long chunksz = 1UL << shift;
+	unsigned long n = (size + chunksz - 1) >> shift;
+	unsigned long off = kCmpDskHeaderSize;
+	unsigned long i;
+	unsigned long j;
+	uLong cbufsz = compressBound(chunksz);
+	unsigned char *cbuf = malloc(cbufsz);
+	unsigned char *idx = malloc(n * 8 + 1);
+
+	if ((NULL == cbuf) || (NULL == idx)) {
+		return 0;
+	}
+
+	memset(h, 0, sizeof(h));
+	if (kCmpDskHeaderSize != fwrite(h, 1, kCmpDskHeaderSize, f)) {
+		return 0;
+	}
+
+	for (i = 0; i < n; ++i) {
+		unsigned char *p = img + (i << shift);
+		unsigned long L = (size - (i << shift) > chunksz)
+			? chunksz : size - (i << shift);
+		uLongf clen = cbufsz;
+
+		for (j = 0; (j < L) && (0 == p[j]); ++j) {
+		}
+		if (j == L) {
+			clen = 0;
+		} else if ((Z_OK == compress2(cbuf, &clen, p, L,
+			Z_BEST_COMPRESSION)) && (clen < L))
+		{
+			p = cbuf;
+		} else {
+			clen = L;
+		}
+		if ((0 != clen) && (clen != fwrite(p, 1, clen, f))) {
+			return 0;
+		}
+		put_long(idx + 8 * i, off);
+		put_long(idx + 8 * i + 4, clen);
+		off += clen;
+	}
+
+	if (n * 8 != fwrite(idx, 1, n * 8, f)) {
+		return 0;
+	}
+
+	put_long(h + 0, kCmpDskMagic);
+	put_long(h + 4, shift);
+	put_long(h + 8, size);
+	put_long(h + 12, n);
+	put_long(h + 16, off);
+	rewind(f);
+	if (kCmpDskHeaderSize != fwrite(h, 1, kCmpDskHeaderSize, f)) {
+		return 0;
+	}
+
+	free(idx);
+	free(cbuf);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int expand = 0;
+	unsigned long shift = kDefaultChunkShift;
+	unsigned long size;
+	unsigned char *img;
+	FILE *fin;
+	FILE *fout;
+	int ok;
+	int i = 1;
+
+	while ((i < argc) && ('-' == argv[i][0])) {
+		if (0 == strcmp(argv[i], "-d")) {
+			expand = 1;
+		} else if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc)) {
+			shift = strtoul(argv[++i], NULL, 10);
+		} else {
+			break;
+		}
+		++i;
+	}
+
+	if ((argc - i != 2)
+		|| (shift < kCmpDskMinChunkShift) || (shift > kCmpDskMaxChunkShift))
+	{
+		fprintf(stderr,
+			"usage: mvzimage [-d] [-s chunkshift (%d-%d)] in out\n",
+			kCmpDskMinChunkShift, kCmpDskMaxChunkShift);
+		return 2;
+	}
+
+	fin = fopen(argv[i], "rb");
+	if (NULL == fin) {
+		return fail("can't open input");
+	}
+	img = load_image(fin, &size);
+	fclose(fin);
+	if (NULL == img) {
+		return fail("can't read input");
+	}
+
+	fout = fopen(argv[i + 1], "wb");
+	if (NULL == fout) {
+		return fail("can't create output");
+	}
+	if (expand) {
+		ok = (size == fwrite(img, 1, size, fout));
+	} else {
+		ok = save_compressed(fout, img, size, shift);
+	}
+	if (0 != fclose(fout)) {
+		ok = 0;
+	}
+	free(img);
+
+	return ok ? 0 : fail("can't write output");
+}
@@ -0,0 +1,378 @@
+/*
+	SCRNCBEN.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	host tool to time the screen conversion kernels of
+	src/SCRNCNVT.h against the ones they replaced, with no
+	rest of the emulator.
+
+	build with the configuration of a variant, for example:
+		cc -O2 -o scrncben -Ivariants/MacII8bpp/cfg -Isrc \
+			tools/SCRNCBEN.c
+	FBTextureCompact defaults as in 3DSGLU.c, and it and
+	ScrnCnvt_Depth can be given with -D, to time the other
+	texture format, or the 2bpp tables no variant uses.
+
+	scrncben [-r reps] [-u updates]
+		for the 1bpp kernel, and the color one of the depth,
+		do updates (default 2000) screen updates of each kind,
+		reps (default 5) times, the way Video_UpdateTexture
+		does them, first as before, rebuilding the tables each
+		update and using the old kernels, then as now, and
+		print one line per kernel and kind of update, for the
+		best of the runs:
+
+		kernel,update,pixels,old_ns,new_ns
+
+	The update kinds are the full screen, 16 full width rows,
+	as when scrolling a line of text, and a 16 by 16 square,
+	as for the cursor. The old and new outputs are compared,
+	any difference is reported on stderr, and then the exit
+	code is 1. There was no old 2bpp kernel, so old_ns is 0.
+*/
+
+#include "SYSDEPNS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/* what SCRNCNVT.h needs from the 3DS headers and the glue */
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#define BIT( n ) ( 1U << ( n ) )
+
+#define RGBA8( r, g, b, a ) ( ( ( r & 0xFF ) << 24 ) | ( ( g & 0xFF ) << 16 ) | ( ( b & 0xFF ) << 8 ) | ( a & 0xFF ) )
+#define RGB565( r, g, b ) ( ( ( r & 0xF8 ) << 8 ) | ( ( g & 0xFC ) << 3 ) | ( ( b & 0xF8 ) >> 3 ) )
+
+#ifndef FBTextureCompact
+#if vMacScreenDepth < 3
+#define FBTextureCompact 1
+#else
+#define FBTextureCompact 0
+#endif
+#endif
+
+#if FBTextureCompact
+typedef u16 fbpixel;
+typedef u32 fbpixel2;
+#define FBPIXEL( r, g, b ) RGB565( r, g, b )
+#else
+typedef u32 fbpixel;
+typedef u64 fbpixel2;
+#define FBPIXEL( r, g, b ) RGBA8( r, g, b, 0xFF )
+#endif
+
+#include "SCRNCNVT.h"
+
+#define kStride 512 /* staging buffer row, in pixels, as in 3DSGLU.c */
+#define kBufPixels (kStride * 512)
+#define kSrcBytes (vMacScreenWidth * vMacScreenHeight)
+	/* enough for 8 bits per pixel */
+
+#define kDefaultReps 5
+#define kDefaultUpdates 2000
+
+enum {
+	kKindFull,
+	kKindRows,
+	kKindCursor,
+	kNumKinds
+};
+
+static char *KindName[kNumKinds] = { "full", "rows", "cursor" };
+
+static ui5r NWrong = 0;
+
+static ui5b RandState = 1;
+
+static u8 Screen[kSrcBytes];
+static u16 Reds[256];
+static u16 Greens[256];
+static u16 Blues[256];
+
+static fbpixel OldBuf[kBufPixels];
+static fbpixel NewBuf[kBufPixels];
+
+static ui5b Rand32(void)
+{
+	/* xorshift, so every host gives the same screen */
+	RandState ^= RandState << 13;
+	RandState ^= RandState >> 17;
+	RandState ^= RandState << 5;
+	return RandState;
+}
+
+static double NowNs(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* the kernels as they were before SCRNCNVT.h */
+
+static void OldConvert1BPP(u8 *Src, fbpixel *Dest, int Size)
+{
+	do {
+		memcpy(Dest, Table1BPP[*Src++], sizeof(fbpixel) * 8);
+
+		Dest += 8;
+		Size -= 8;
+	} while (Size > 0);
+}
+
+#if ScrnCnvt_Depth == 2
+static void OldConvert4BPP(u8 *Src, fbpixel2 *Dest, int Size)
+{
+	do {
+		*Dest++ = Table4BPP[*Src++];
+		Size -= 2;
+	} while (Size > 0);
+}
+#elif ScrnCnvt_Depth == 3
+static void OldConvert8BPP(u8 *Src, fbpixel *Dest, int Size)
+{
+	while (Size--) {
+		*Dest++ = Table8BPP[*Src++];
+	}
+}
+#endif
+
+static void MakeColorTable(void)
+{
+#if ScrnCnvt_Depth == 1
+	MakeTable2BPP(Reds, Greens, Blues);
+#elif ScrnCnvt_Depth == 2
+	MakeTable4BPP(Reds, Greens, Blues);
+#elif ScrnCnvt_Depth == 3
+	MakeTable8BPP(Reds, Greens, Blues);
+#endif
+}
+
+/*
+	one update, as Video_UpdateTexture does it, with Depth
+	bits per pixel. IsOld rebuilds the tables first, as was
+	done for every update, and uses the old kernels.
+*/
+static void Update(blnr IsOld, int Depth, fbpixel *Buf,
+	int Left, int Right, int Top, int Bottom)
+{
+	fbpixel *Dest;
+	u8 *Src;
+	int PerByte = 8 / Depth;
+
+	if (1 == Depth) {
+		Left &= ~7;
+		Right = (Right + 8) & ~7;
+	} else if (2 == Depth) {
+		Left &= ~3;
+		Right = (Right + 3) & ~3;
+	} else if (4 == Depth) {
+		Left &= ~1;
+		Right = (Right + 1) & ~1;
+	}
+	if (Right > vMacScreenWidth) {
+		Right = vMacScreenWidth;
+	}
+
+	if (IsOld) {
+		if (1 == Depth) {
+			MakeTable1BPP();
+		} else {
+			MakeColorTable();
+		}
+	}
+
+	for (; Top < Bottom; ++Top) {
+		Dest = &Buf[Top * kStride + Left];
+		Src = &Screen[(Top * vMacScreenWidth) / PerByte
+			+ Left / PerByte];
+
+		if (1 == Depth) {
+			if (IsOld) {
+				OldConvert1BPP(Src, Dest, Right - Left);
+			} else {
+				Convert1BPP(Src, Dest, Right - Left);
+			}
+		} else {
+#if ScrnCnvt_Depth == 1
+			Convert2BPP(Src, Dest, Right - Left);
+#elif ScrnCnvt_Depth == 2
+			if (IsOld) {
+				OldConvert4BPP(Src, (fbpixel2 *)Dest, Right - Left);
+			} else {
+				Convert4BPP(Src, (fbpixel2 *)Dest, Right - Left);
+			}
+#elif ScrnCnvt_Depth == 3
+			if (IsOld) {
+				OldConvert8BPP(Src, Dest, Right - Left);
+			} else {
+				Convert8BPP(Src, Dest, Right - Left);
+			}
+#endif
+		}
+	}
+}
+
+static void KindRect(int Kind, int i,
+	int *Left, int *Right, int *Top, int *Bottom)
+{
+	switch (Kind) {
+		case kKindFull:
+		default:
+			*Left = 0;
+			*Right = vMacScreenWidth;
+			*Top = 0;
+			*Bottom = vMacScreenHeight;
+			break;
+		case kKindRows:
+			/* walk down the screen, a line of text at a time */
+			*Left = 0;
+			*Right = vMacScreenWidth;
+			*Top = (i * 16) % (vMacScreenHeight - 16);
+			*Bottom = *Top + 16;
+			break;
+		case kKindCursor:
+			/* odd places, so the alignment is exercised */
+			*Left = (i * 37) % (vMacScreenWidth - 16);
+			*Right = *Left + 16;
+			*Top = (i * 23) % (vMacScreenHeight - 16);
+			*Bottom = *Top + 16;
+			break;
+	}
+}
+
+static double TimeUpdates(blnr IsOld, int Depth, int Kind,
+	int Reps, int Updates, fbpixel *Buf)
+{
+	int Left;
+	int Right;
+	int Top;
+	int Bottom;
+	double t0;
+	double t;
+	double Best = 0;
+	int i;
+	int j;
+
+	for (j = 0; j < Reps; ++j) {
+		t0 = NowNs();
+		for (i = 0; i < Updates; ++i) {
+			KindRect(Kind, i, &Left, &Right, &Top, &Bottom);
+			Update(IsOld, Depth, Buf, Left, Right, Top, Bottom);
+		}
+		t = NowNs() - t0;
+		if ((0 == j) || (t < Best)) {
+			Best = t;
+		}
+	}
+
+	return Best / Updates;
+}
+
+static void RunKernel(char *Name, int Depth, int Reps, int Updates)
+{
+	int Kind;
+	int Left;
+	int Right;
+	int Top;
+	int Bottom;
+	double OldNs;
+	double NewNs;
+	ui5r i;
+
+	/* the tables the new kernels expect to be there already */
+	MakeTable1BPP();
+	MakeColorTable();
+
+	for (Kind = 0; Kind < kNumKinds; ++Kind) {
+		memset(OldBuf, 0, sizeof(OldBuf));
+		memset(NewBuf, 0, sizeof(NewBuf));
+
+		OldNs = (2 == Depth) ? 0
+			: TimeUpdates(trueblnr, Depth, Kind, Reps, Updates, OldBuf);
+		NewNs = TimeUpdates(falseblnr, Depth, Kind, Reps, Updates,
+			NewBuf);
+
+		KindRect(Kind, 0, &Left, &Right, &Top, &Bottom);
+		printf("%s,%s,%d,%.0f,%.0f\n", Name, KindName[Kind],
+			(Right - Left) * (Bottom - Top), OldNs, NewNs);
+
+		if (2 != Depth) {
+			for (i = 0; i < kBufPixels; ++i) {
+				if (OldBuf[i] != NewBuf[i]) {
+					fprintf(stderr,
+						"scrncben: %s %s differs at row %lu column %lu\n",
+						Name, KindName[Kind],
+						(unsigned long)(i / kStride),
+						(unsigned long)(i % kStride));
+					++NWrong;
+					break;
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int Reps = kDefaultReps;
+	int Updates = kDefaultUpdates;
+#if ScrnCnvt_Depth != 0
+	char Name[8];
+#endif
+	ui5r i;
+	int j = 1;
+
+	while ((j + 1 < argc) && ('-' == argv[j][0])) {
+		if (0 == strcmp(argv[j], "-r")) {
+			Reps = atoi(argv[j + 1]);
+		} else if (0 == strcmp(argv[j], "-u")) {
+			Updates = atoi(argv[j + 1]);
+		} else {
+			break;
+		}
+		j += 2;
+	}
+	if ((j < argc) || (Reps < 1) || (Updates < 1)) {
+		fprintf(stderr, "usage: scrncben [-r reps] [-u updates]\n");
+		return 1;
+	}
+
+	for (i = 0; i < kSrcBytes; ++i) {
+		Screen[i] = (u8)Rand32();
+	}
+	for (i = 0; i < 256; ++i) {
+		Reds[i] = (u16)Rand32();
+		Greens[i] = (u16)Rand32();
+		Blues[i] = (u16)Rand32();
+	}
+
+	printf("kernel,update,pixels,old_ns,new_ns\n");
+	RunKernel("1bpp", 1, Reps, Updates);
+#if ScrnCnvt_Depth != 0
+	sprintf(Name, "%dbpp", 1 << ScrnCnvt_Depth);
+	RunKernel(Name, 1 << ScrnCnvt_Depth, Reps, Updates);
+#endif
+
+	return (0 == NWrong) ? 0 : 1;
+}
@@ -0,0 +1,307 @@
+/*
+	SCRNTCHK.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	host tool to check the screen tile dirty tracking
+	(src/SCRNTILE.h), with no rest of the emulator.
+
+	build with the configuration of any variant, for example:
+		cc -O2 -o scrntchk -Ivariants/MacII8bpp/cfg -Isrc \
+			tools/SCRNTCHK.c
+	ScrnTile_Height defaults to 512, as in 3DSGLU.c, and it
+	and the optional arguments of SCRNTILE.h can be given
+	with -D, to check other shapes.
+
+	scrntchk [-n count] [-s seed]
+		run some fixed cases, for ScrnTile_NoteRows and
+		ScrnTile_NoteAll, for the merging of dirty runs
+		across small gaps in ScrnTile_TakeSpans, and for
+		the last span taking in the rest once MaxSpans is
+		reached, then count (default 100000) random ones from
+		seed (default 1), compare each against a simple model
+		kept here, and print
+
+		cases,wrong
+
+	and list the first few wrong ones on stderr.
+*/
+
+#include "SYSDEPNS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef ScrnTile_Height
+#define ScrnTile_Height 512
+#endif
+#include "SCRNTILE.h"
+
+#define kMaxWrongShown 16
+#define kMaxNotes 8 /* NoteRows calls in a random case */
+
+#define kDefaultCount 100000
+
+#define kRoundedHeight (kScrnTileNBands << kScrnTileShift)
+
+static ui5r NCases = 0;
+static ui5r NWrong = 0;
+
+static ui5b RandState;
+
+/* one flag per band, what SCRNTILE.h should have noted */
+static blnr ModelDirty[kScrnTileNBands];
+
+static ui5b Rand32(void)
+{
+	/* xorshift, so every host gives the same cases */
+	RandState ^= RandState << 13;
+	RandState ^= RandState >> 17;
+	RandState ^= RandState << 5;
+	return RandState;
+}
+
+static void NoteRows(si4r Top, si4r Bottom)
+{
+	si4r i;
+
+	ScrnTile_NoteRows(Top, Bottom);
+
+	for (i = 0; i < ScrnTile_Height; ++i) {
+		if ((i >= Top) && (i < Bottom)) {
+			ModelDirty[i >> kScrnTileShift] = trueblnr;
+		}
+	}
+}
+
+static void NoteAll(void)
+{
+	int i;
+
+	ScrnTile_NoteAll();
+
+	for (i = 0; i < kScrnTileNBands; ++i) {
+		ModelDirty[i] = trueblnr;
+	}
+}
+
+/*
+	the spans the model gives: runs of dirty bands, joined
+	where the gap is kScrnTileMergeGap bands or less, and
+	those past MaxSpans folded into the last
+*/
+static int ModelSpans(ScrnTileSpan *Spans, int MaxSpans)
+{
+	int i;
+	int n = 0;
+
+	for (i = 0; i < kScrnTileNBands; ++i) {
+		if (ModelDirty[i]) {
+			if ((0 != n)
+				&& ((i << kScrnTileShift) - Spans[n - 1].Bottom
+					<= (kScrnTileMergeGap << kScrnTileShift)))
+			{
+				Spans[n - 1].Bottom = (i + 1) << kScrnTileShift;
+			} else {
+				Spans[n].Top = i << kScrnTileShift;
+				Spans[n].Bottom = (i + 1) << kScrnTileShift;
+				++n;
+			}
+		}
+		ModelDirty[i] = falseblnr;
+	}
+
+	if (n > MaxSpans) {
+		Spans[MaxSpans - 1].Bottom = Spans[n - 1].Bottom;
+		n = MaxSpans;
+	}
+
+	return n;
+}
+
+static void ShowSpans(char *What, ScrnTileSpan *Spans, int n)
+{
+	int i;
+
+	fprintf(stderr, " %s", What);
+	for (i = 0; i < n; ++i) {
+		fprintf(stderr, " %u-%u",
+			(unsigned)Spans[i].Top, (unsigned)Spans[i].Bottom);
+	}
+}
+
+/*
+	take the spans, and check them against the model, and
+	that the next take finds nothing left
+*/
+static void CheckSpans(char *Name, int MaxSpans)
+{
+	ScrnTileSpan Got[kScrnTileNBands];
+	ScrnTileSpan Want[kScrnTileNBands];
+	ScrnTileSpan Again[1];
+	int GotN = ScrnTile_TakeSpans(Got, MaxSpans);
+	int WantN = ModelSpans(Want, MaxSpans);
+	int AgainN = ScrnTile_TakeSpans(Again, 1);
+	blnr IsOk = (GotN == WantN) && (0 == AgainN);
+	int i;
+
+	for (i = 0; IsOk && (i < GotN); ++i) {
+		if ((Got[i].Top != Want[i].Top)
+			|| (Got[i].Bottom != Want[i].Bottom)
+			|| (Got[i].Bottom > kRoundedHeight))
+		{
+			IsOk = falseblnr;
+		}
+	}
+
+	if (! IsOk) {
+		if (NWrong < kMaxWrongShown) {
+			fprintf(stderr, "scrntchk: %s, max %d:", Name, MaxSpans);
+			ShowSpans("gave", Got, GotN);
+			ShowSpans("not", Want, WantN);
+			if (0 != AgainN) {
+				fprintf(stderr, " and did not clear");
+			}
+			fprintf(stderr, "\n");
+		}
+		++NWrong;
+	}
+	++NCases;
+}
+
+static void FixedCases(void)
+{
+	ScrnTileSpan s[1];
+	si4r b = kScrnTileRows;
+	si4r g = (kScrnTileMergeGap + 1) * kScrnTileRows;
+		/* from the start of a band to one just too far to join */
+
+	CheckSpans("nothing", kScrnTileMaxSpans);
+
+	NoteAll();
+	CheckSpans("all", kScrnTileMaxSpans);
+	NoteAll();
+	CheckSpans("all, one span", 1);
+
+	NoteRows(b + 2, b + 3);
+	CheckSpans("one row", kScrnTileMaxSpans);
+	NoteRows(b, 2 * b);
+	CheckSpans("one whole band", kScrnTileMaxSpans);
+	NoteRows(b, 2 * b + 1);
+	CheckSpans("one row over a band", kScrnTileMaxSpans);
+	NoteRows(b - 1, b + 1);
+	CheckSpans("across a band edge", kScrnTileMaxSpans);
+	NoteRows(- 5, 1);
+	CheckSpans("from above the top", kScrnTileMaxSpans);
+	NoteRows(ScrnTile_Height - 1, ScrnTile_Height + 7);
+	CheckSpans("past the bottom", kScrnTileMaxSpans);
+	NoteRows(3 * b, 3 * b);
+	NoteRows(4 * b, 2 * b);
+	CheckSpans("empty ranges", kScrnTileMaxSpans);
+
+	/* bands 1 and 1 + kScrnTileMergeGap + 1, joined */
+	NoteRows(b, 2 * b);
+	NoteRows(b + g, 2 * b + g);
+	CheckSpans("gap that joins", kScrnTileMaxSpans);
+	/* one band further apart, not joined */
+	NoteRows(b, 2 * b);
+	NoteRows(2 * b + g, 3 * b + g);
+	CheckSpans("gap that doesn't", kScrnTileMaxSpans);
+	/* a chain of gaps that join, one span */
+	NoteRows(0, 1);
+	NoteRows(g, g + 1);
+	NoteRows(2 * g, 2 * g + 1);
+	NoteRows(3 * g, 3 * g + 1);
+	CheckSpans("chain of gaps", kScrnTileMaxSpans);
+
+	if (kScrnTileNBands >= (2 * kScrnTileMaxSpans + 2)
+		* (kScrnTileMergeGap + 2))
+	{
+		/* more separate runs than spans, the rest go in the last */
+		int i;
+
+		for (i = 0; i < kScrnTileMaxSpans + 2; ++i) {
+			NoteRows(i * (g + b), i * (g + b) + 1);
+		}
+		CheckSpans("too many runs", kScrnTileMaxSpans);
+		for (i = 0; i < kScrnTileMaxSpans + 2; ++i) {
+			NoteRows(i * (g + b), i * (g + b) + 1);
+		}
+		CheckSpans("too many runs, one span", 1);
+	}
+
+	/* a take with nothing noted, after all the above */
+	(void) ScrnTile_TakeSpans(s, 1);
+	CheckSpans("nothing again", kScrnTileMaxSpans);
+}
+
+static void RandomCases(ui5r n)
+{
+	ui5r i;
+	int j;
+	int k;
+	si4r Top;
+	si4r Bottom;
+
+	for (i = 0; i < n; ++i) {
+		k = 1 + Rand32() % kMaxNotes;
+		for (j = 0; j < k; ++j) {
+			if (0 == (Rand32() % 64)) {
+				NoteAll();
+			} else {
+				Top = (si4r)(Rand32() % (ScrnTile_Height + 16)) - 8;
+				if (0 == (Rand32() & 1)) {
+					/* short, like a cursor or a text line */
+					Bottom = Top + (si4r)(Rand32() % 24);
+				} else {
+					Bottom = (si4r)(Rand32() % (ScrnTile_Height + 16))
+						- 8;
+				}
+				NoteRows(Top, Bottom);
+			}
+		}
+		CheckSpans("random", 1 + Rand32() % kScrnTileMaxSpans);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	long Count = kDefaultCount;
+	unsigned long Seed = 1;
+	int i = 1;
+
+	while ((i + 1 < argc) && ('-' == argv[i][0])) {
+		if (0 == strcmp(argv[i], "-n")) {
+			Count = atol(argv[i + 1]);
+		} else if (0 == strcmp(argv[i], "-s")) {
+			Seed = strtoul(argv[i + 1], NULL, 0);
+		} else {
+			break;
+		}
+		i += 2;
+	}
+	if ((i < argc) || (Count < 0) || (0 == (ui5b)Seed)) {
+		fprintf(stderr, "usage: scrntchk [-n count] [-s seed]\n");
+		return 1;
+	}
+	RandState = (ui5b)Seed;
+
+	FixedCases();
+	RandomCases((ui5r)Count);
+
+	printf("cases,wrong\n%lu,%lu\n",
+		(unsigned long)NCases, (unsigned long)NWrong);
+
+	return (0 == NWrong) ? 0 : 1;
+}
@@ -0,0 +1,390 @@
+/*
+	SCRNWBEN.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	host tool to time, per emulated frame, finding what changed
+	on the screen (src/SCRNFIND.h) and converting it into the
+	staging buffer (src/SCRNCNVT.h), with no rest of the
+	emulator. The screen is drawn to here directly, standing in
+	for the emulated machine.
+
+	build with the configuration of a variant with video
+	memory, once with writes tracked, and once comparing
+	against a copy of the screen, as before ScreenWriteTracked:
+		cc -O2 -o scrnwben -Ivariants/MacII8bpp/cfg -Isrc \
+			tools/SCRNWBEN.c
+		cc -O2 -DScreenWriteTracked=0 -o scrnwben0 ...
+
+	scrnwben [-r reps] [-f frames]
+		draw frames (default 600) frames of each kind, reps
+		(default 5) times, in the colors of the variant, and
+		print one line per kind, for the best of the runs:
+
+		kind,pages,rows,find_ns,convert_ns,total_ns
+
+	pages is the video memory pages written per frame, and so
+	the write traps taken with ScreenWriteTracked, rows is the
+	rows converted per frame, and the times are per frame. The
+	time a write trap takes in the CPU emulation is not here.
+
+	The kinds are idle, nothing drawn, cursor, a 16 by 16
+	square moving about, typing, one 8 by 16 character cell
+	at a time along a line, scroll, a window of most of the
+	screen scrolled up a 16 row line, and full, every pixel
+	changed.
+*/
+
+#include "SYSDEPNS.h"
+
+#include "ENDIANAC.h"
+#include "MYOSGLUE.h"
+#include "EMCONFIG.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#if ! IncludeVidMem
+#error "scrnwben needs a variant with video memory"
+#endif
+
+/* what SCRNCNVT.h needs from the 3DS headers and the glue */
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+#define BIT( n ) ( 1U << ( n ) )
+
+#define RGBA8( r, g, b, a ) ( ( ( r & 0xFF ) << 24 ) | ( ( g & 0xFF ) << 16 ) | ( ( b & 0xFF ) << 8 ) | ( a & 0xFF ) )
+#define RGB565( r, g, b ) ( ( ( r & 0xF8 ) << 8 ) | ( ( g & 0xFC ) << 3 ) | ( ( b & 0xF8 ) >> 3 ) )
+
+#ifndef FBTextureCompact
+#if vMacScreenDepth < 3
+#define FBTextureCompact 1
+#else
+#define FBTextureCompact 0
+#endif
+#endif
+
+#if FBTextureCompact
+typedef u16 fbpixel;
+typedef u32 fbpixel2;
+#define FBPIXEL( r, g, b ) RGB565( r, g, b )
+#else
+typedef u32 fbpixel;
+typedef u64 fbpixel2;
+#define FBPIXEL( r, g, b ) RGBA8( r, g, b, 0xFF )
+#endif
+
+#include "SCRNCNVT.h"
+
+/* what SCRNFIND.h needs from the rest of the glue */
+
+GLOBALVAR blnr UseColorMode = trueblnr;
+GLOBALVAR blnr ColorMappingChanged = falseblnr;
+
+GLOBALOSGLUPROC MyMoveBytes(anyp srcPtr, anyp destPtr, si5b byteCount)
+{
+	(void) memmove((void *)destPtr, (void *)srcPtr, byteCount);
+}
+
+#include "SCRNFIND.h"
+
+#define kStride 512 /* staging buffer row, in pixels, as in 3DSGLU.c */
+#define kRowBytes vMacScreenByteWidth
+#define kPageSize (kVidMemRAM_Size / 32)
+	/* as kVidMemTrackPageSize in GLOBGLUE.c */
+
+#define kDefaultReps 5
+#define kDefaultFrames 600
+
+enum {
+	kKindIdle,
+	kKindCursor,
+	kKindTyping,
+	kKindScroll,
+	kKindFull,
+	kNumKinds
+};
+
+static char *KindName[kNumKinds] = {
+	"idle", "cursor", "typing", "scroll", "full"
+};
+
+static ui5b RandState = 1;
+
+static ui3b Screen[kVidMemRAM_Size];
+#if ! ScreenWriteTracked
+static ui3b CompareBuff[vMacScreenNumBytes];
+#endif
+static fbpixel StagingBuf[kStride * 512];
+static u16 Reds[256];
+static u16 Greens[256];
+static u16 Blues[256];
+
+static ui5b Rand32(void)
+{
+	/* xorshift, so every host gives the same screens */
+	RandState ^= RandState << 13;
+	RandState ^= RandState >> 17;
+	RandState ^= RandState << 5;
+	return RandState;
+}
+
+static double NowNs(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* invert a rectangle, given in pixels, a row at a time */
+static void InvertRect(int Left, int Right, int Top, int Bottom)
+{
+	int i;
+	int j;
+	int L = (Left << vMacScreenDepth) / 8;
+	int R = ((Right << vMacScreenDepth) + 7) / 8;
+
+	for (i = Top; i < Bottom; ++i) {
+		for (j = L; j < R; ++j) {
+			Screen[i * kRowBytes + j] ^= 0xFF;
+		}
+	}
+}
+
+/*
+	draw a frame of the kind, and give back the range of
+	video memory written to, in bytes, or an empty range.
+*/
+static void Draw(int Kind, int f, ui5r *Start, ui5r *End)
+{
+	int i;
+	int x;
+	int y;
+
+	*Start = 0;
+	*End = 0;
+
+	switch (Kind) {
+		case kKindIdle:
+		default:
+			break;
+		case kKindCursor:
+			x = (f * 7) % (vMacScreenWidth - 16);
+			y = (f * 5) % (vMacScreenHeight - 16);
+			InvertRect(x, x + 16, y, y + 16);
+			*Start = y * kRowBytes;
+			*End = (y + 16) * kRowBytes;
+			break;
+		case kKindTyping:
+			x = 16 + (f * 8) % (vMacScreenWidth - 40);
+			y = 100;
+			InvertRect(x, x + 8, y, y + 16);
+			*Start = y * kRowBytes;
+			*End = (y + 16) * kRowBytes;
+			break;
+		case kKindScroll:
+			/*
+				a window from row 40 to 20 from the bottom, and
+				16 pixels in from each side, moved up 16 rows,
+				with new rows at the bottom
+			*/
+			x = (16 << vMacScreenDepth) / 8;
+			for (y = 40; y < vMacScreenHeight - 20; ++y) {
+				if (y < vMacScreenHeight - 36) {
+					(void) memmove(&Screen[y * kRowBytes + x],
+						&Screen[(y + 16) * kRowBytes + x],
+						kRowBytes - 2 * x);
+				} else {
+					for (i = x; i < kRowBytes - x; ++i) {
+						Screen[y * kRowBytes + i] = (ui3b)Rand32();
+					}
+				}
+			}
+			*Start = 40 * kRowBytes;
+			*End = (vMacScreenHeight - 20) * kRowBytes;
+			break;
+		case kKindFull:
+			InvertRect(0, vMacScreenWidth, 0, vMacScreenHeight);
+			*Start = 0;
+			*End = vMacScreenNumBytes;
+			break;
+	}
+}
+
+/* the changed rectangle into the staging buffer, as 3DSGLU.c does */
+static void Convert(int Left, int Right, int Top, int Bottom)
+{
+	fbpixel *Dest;
+	u8 *Src;
+	int PerByte = 8 >> vMacScreenDepth;
+
+#if vMacScreenDepth == 1
+	Left &= ~3;
+	Right = (Right + 3) & ~3;
+#elif vMacScreenDepth == 2
+	Left &= ~1;
+	Right = (Right + 1) & ~1;
+#endif
+
+	for (; Top < Bottom; ++Top) {
+		Dest = &StagingBuf[Top * kStride + Left];
+		Src = &Screen[Top * kRowBytes + Left / PerByte];
+#if vMacScreenDepth == 1
+		Convert2BPP(Src, Dest, Right - Left);
+#elif vMacScreenDepth == 2
+		Convert4BPP(Src, (fbpixel2 *)Dest, Right - Left);
+#elif vMacScreenDepth == 3
+		Convert8BPP(Src, Dest, Right - Left);
+#endif
+	}
+}
+
+static void RunKind(int Kind, int Reps, int Frames)
+{
+	ui5r Start;
+	ui5r End;
+	si4b top;
+	si4b left;
+	si4b bottom;
+	si4b right;
+	double t0;
+	double t1;
+	double Find;
+	double Conv;
+	double BestFind = 0;
+	double BestConv = 0;
+	ui5r Pages = 0;
+	ui5r Rows = 0;
+	int f;
+	int j;
+
+	for (j = 0; j < Reps; ++j) {
+		Find = 0;
+		Conv = 0;
+		Pages = 0;
+		Rows = 0;
+		for (f = 0; f < Frames; ++f) {
+			Draw(Kind, f, &Start, &End);
+#if ScreenWriteTracked
+			if (End > Start) {
+				/* whole pages, as VidMemTrack_TakeDirty gives */
+				Start -= Start % kPageSize;
+				End += kPageSize - 1;
+				End -= End % kPageSize;
+				Pages += (End - Start) / kPageSize;
+			}
+#else
+			if (End > Start) {
+				Pages += (End - 1) / kPageSize - Start / kPageSize + 1;
+			}
+#endif
+
+			t0 = NowNs();
+#if ScreenWriteTracked
+			screencomparebuff = Screen;
+			if (End > Start) {
+				Screen_NoteWritten(Start, End);
+			}
+#endif
+			if (ScreenFindChanges(Screen, 0,
+				&top, &left, &bottom, &right))
+			{
+				t1 = NowNs();
+				Find += t1 - t0;
+				Convert(left, right, top, bottom);
+				Conv += NowNs() - t1;
+				Rows += bottom - top;
+			} else {
+				Find += NowNs() - t0;
+			}
+		}
+		if ((0 == j) || (Find + Conv < BestFind + BestConv)) {
+			BestFind = Find;
+			BestConv = Conv;
+		}
+	}
+
+	printf("%s,%.1f,%.1f,%.0f,%.0f,%.0f\n", KindName[Kind],
+		(double)Pages / Frames, (double)Rows / Frames,
+		BestFind / Frames, BestConv / Frames,
+		(BestFind + BestConv) / Frames);
+}
+
+int main(int argc, char **argv)
+{
+	int Reps = kDefaultReps;
+	int Frames = kDefaultFrames;
+	si4b top;
+	si4b left;
+	si4b bottom;
+	si4b right;
+	ui5r i;
+	int Kind;
+	int j = 1;
+
+	while ((j + 1 < argc) && ('-' == argv[j][0])) {
+		if (0 == strcmp(argv[j], "-r")) {
+			Reps = atoi(argv[j + 1]);
+		} else if (0 == strcmp(argv[j], "-f")) {
+			Frames = atoi(argv[j + 1]);
+		} else {
+			break;
+		}
+		j += 2;
+	}
+	if ((j < argc) || (Reps < 1) || (Frames < 1)) {
+		fprintf(stderr, "usage: scrnwben [-r reps] [-f frames]\n");
+		return 1;
+	}
+
+	for (i = 0; i < vMacScreenNumBytes; ++i) {
+		Screen[i] = (ui3b)Rand32();
+	}
+	for (i = 0; i < 256; ++i) {
+		Reds[i] = (u16)Rand32();
+		Greens[i] = (u16)Rand32();
+		Blues[i] = (u16)Rand32();
+	}
+	MakeTable1BPP(); /* as the glue does, though unused here */
+#if vMacScreenDepth == 1
+	MakeTable2BPP(Reds, Greens, Blues);
+#elif vMacScreenDepth == 2
+	MakeTable4BPP(Reds, Greens, Blues);
+#elif vMacScreenDepth == 3
+	MakeTable8BPP(Reds, Greens, Blues);
+#endif
+
+	/* the first frame, which is all of the screen either way */
+#if ScreenWriteTracked
+	screencomparebuff = Screen;
+	Screen_NoteWritten(0, vMacScreenNumBytes);
+#else
+	screencomparebuff = CompareBuff;
+#endif
+	(void) ScreenFindChanges(Screen, 0, &top, &left, &bottom, &right);
+
+	printf("kind,pages,rows,find_ns,convert_ns,total_ns\n");
+	for (Kind = 0; Kind < kNumKinds; ++Kind) {
+		RunKind(Kind, Reps, Frames);
+	}
+
+	return 0;
+}
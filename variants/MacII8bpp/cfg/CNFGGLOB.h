@@ -16,7 +16,12 @@
 #define LittleEndianUnaligned 0
 #define my_cond_rare(x) (__builtin_expect(x, 0))
 #define Have_ASR 1
+#ifndef HaveGlbReg
 #define HaveGlbReg 1
+#endif
+#ifndef UseThreadedDispatch
+#define UseThreadedDispatch 0
+#endif
 #define my_align_8 __attribute__ ((aligned (8)))
 #define SmallGlobals 0
 #define cIncludeUnused 0
@@ -42,8 +47,10 @@ typedef unsigned long ui5b;
 typedef long si5b;
 #define HaveRealsi5b 1
 
-#define HaveRealui6b 0
-#define HaveRealsi6b 0
+#ifndef HaveRealui6b
+#define HaveRealui6b 1
+#endif
+#define HaveRealsi6b 1
 
 /* --- integer representation types ---- */
 
@@ -82,6 +89,8 @@ typedef unsigned long long ui6b;
 #define kLn2SoundSampSz 4
 
 #define dbglog_HAVE 0
+#define WantTraceRing 0
+#define WantTrapProfile 0
 
 #define NumDrives 6
 #define IncludeSonyRawMode 0
@@ -92,6 +101,9 @@ typedef unsigned long long ui6b;
 #define vMacScreenHeight 384
 #define vMacScreenWidth 512
 #define vMacScreenDepth 3
+#ifndef ScreenWriteTracked
+#define ScreenWriteTracked 1
+#endif
 
 #define kROM_Size 0x00040000
 
@@ -102,4 +114,5 @@ typedef unsigned long long ui6b;
 
 #define IncludeHostTextClipExchange 0
 #define EnableAutoSlow 0
+#define EnableAutoTurbo 1
 #define EmLocalTalk 0
@@ -38,7 +38,7 @@
 #define EmVidCard 1
 #define kVidROM_Size 0x000800
 
-#define MaxATTListN 20
+#define MaxATTListN 52
 #define IncludeExtnPbufs 0
 #define IncludeExtnHostTextClipExchange 0
 
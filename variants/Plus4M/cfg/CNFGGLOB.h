@@ -16,7 +16,12 @@
 #define LittleEndianUnaligned 0
 #define my_cond_rare(x) (__builtin_expect(x, 0))
 #define Have_ASR 1
+#ifndef HaveGlbReg
 #define HaveGlbReg 1
+#endif
+#ifndef UseThreadedDispatch
+#define UseThreadedDispatch 0
+#endif
 #define my_align_8 __attribute__ ((aligned (8)))
 #define SmallGlobals 0
 #define cIncludeUnused 0
@@ -42,8 +47,10 @@ typedef unsigned long ui5b;
 typedef long si5b;
 #define HaveRealsi5b 1
 
-#define HaveRealui6b 0
-#define HaveRealsi6b 0
+#ifndef HaveRealui6b
+#define HaveRealui6b 1
+#endif
+#define HaveRealsi6b 1
 
 /* --- integer representation types ---- */
 
@@ -68,6 +75,12 @@ typedef si5b si5r;
 #define MySwapUi5r(x) ((ui5r)__builtin_bswap32(x))
 #define HaveMySwapUi5r 1
 
+typedef signed long long si6r;
+typedef signed long long si6b;
+typedef unsigned long long ui6r;
+typedef unsigned long long ui6b;
+#define LIT64(a) a##ULL
+
 /* capabilities provided by platform specific code */
 
 #define MySoundEnabled 0
@@ -76,6 +89,8 @@ typedef si5b si5r;
 #define kLn2SoundSampSz 3
 
 #define dbglog_HAVE 0
+#define WantTraceRing 0
+#define WantTrapProfile 0
 
 #define NumDrives 6
 #define IncludeSonyRawMode 0
@@ -96,4 +111,5 @@ typedef si5b si5r;
 
 #define IncludeHostTextClipExchange 0
 #define EnableAutoSlow 0
+#define EnableAutoTurbo 1
 #define EmLocalTalk 0
@@ -10,6 +10,7 @@
 #include <3ds.h>
 #include <citro3d.h>
 #include <png.h>
+#include <zlib.h>
 
 #include <stdio.h>
 #include <stdlib.h>